@@ -0,0 +1,18 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <string>
+#include "mappedfile.h"
+
+// Single lookup for every file the viewer reads. A path is resolved against the files on disk,
+// then the resources embedded at build time, then the bake cache, so local edits override the
+// embedded copies. The file is a view of the content either way, mapped from disk or pointing
+// into the executable's data. Safe to call from any thread.
+namespace Assets {
+	// Directory of the bake cache, relative to the working directory
+	const char* const CACHE_DIRECTORY = "cache";
+
+	bool open(const std::string& path, MappedFile& file);
+}
+
+#endif //ASSETS_H
@@ -0,0 +1,47 @@
+#ifndef BAKECACHE_H
+#define BAKECACHE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "assets.h"
+#include "texturelevels.h"
+
+// On-disk cache of baked textures. Entries are binary blobs holding every face and mip level
+// as they are stored on the GPU, the least recently used entries are evicted once the
+// directory grows past maxSize bytes.
+class BakeCache
+{
+public:
+	typedef TextureLevels Levels;
+
+	BakeCache(const std::string& directory = Assets::CACHE_DIRECTORY, uintmax_t maxSize = 1024ull * 1024ull * 1024ull);
+
+	bool loadData(const std::string& name, std::vector<char>& data) const;
+	void storeData(const std::string& name, const void* data, size_t size) const;
+
+	// CPU side of load/store, safe to call from worker threads. Maps the entry instead of
+	// reading it, the levels point into file
+	bool mapLevels(const std::string& name, MappedFile& file, Levels& levels) const;
+	void writeLevels(const std::string& name, const Levels& levels) const;
+
+	// GPU side of load/store
+	static void uploadLevel(const Levels& levels, GLenum target, GLuint id, int mip, int face);
+	static bool allocateLevels(GLenum target, GLuint id, int faces, int mipLevels, Levels& levels);
+	static void downloadLevel(Levels& levels, GLenum target, GLuint id, int mip, int face);
+	// Whether the context can sample the internal format, compressed formats need their extension
+	static bool supportsFormat(GLint internalFormat);
+
+	// Removes the least recently used entries past the maximum size. Scans the whole directory,
+	// called once a bake or load stored all its entries rather than after each one.
+	void evict() const;
+
+private:
+	std::string mDirectory;
+	uintmax_t mMaxSize;
+
+	std::string entryPath(const std::string& name) const;
+};
+
+#endif //BAKECACHE_H
@@ -0,0 +1,19 @@
+#ifndef BC6H_H
+#define BC6H_H
+
+#include <cstddef>
+#include <cstdint>
+
+// BC6H unsigned float encoder. Every block uses mode 11: a single region with 10-bit endpoints
+// and 4-bit indices, which keeps the encoder simple and has no visible banding on IBL content.
+namespace BC6H {
+	const size_t BLOCK_BYTES = 16;
+
+	size_t compressedSize(int width, int height);
+
+	// Encodes the 4x4 block at block coordinates (blockX, blockY) of an RGB half float image.
+	// Texels past the image edges repeat the last column and row.
+	void encodeBlock(const uint16_t* rgb, int width, int height, int blockX, int blockY, uint8_t* block);
+}
+
+#endif //BC6H_H
@@ -0,0 +1,37 @@
+#ifndef BCN_H
+#define BCN_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include "texturelevels.h"
+
+// Block compression of 8-bit material maps. BC1 and BC7 fit the endpoints along the principal
+// axis of the block, refine them once with least squares and keep the refinement only when it
+// lowers the error. BC7 only uses mode 6: a single region with RGBA endpoints and 4-bit indices.
+// BC4 takes the smallest and largest value of the block as endpoints, in its eight value mode,
+// and BC5 encodes its two channels as two BC4 blocks. Texels are compared in their stored space,
+// sRGB colors aren't linearized.
+namespace BCn {
+	const size_t BC1_BLOCK_BYTES = 8;
+	const size_t BC4_BLOCK_BYTES = 8;
+	const size_t BC5_BLOCK_BYTES = 16;
+	const size_t BC7_BLOCK_BYTES = 16;
+
+	// Encode the 4x4 block at block coordinates (blockX, blockY) of an 8-bit image with 1, 2 or 4
+	// channels. Texels past the image edges repeat the last column and row.
+	void encodeBC1Block(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, uint8_t* block);
+	void encodeBC4Block(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, int channel, uint8_t* block);
+	void encodeBC5Block(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, uint8_t* block);
+	void encodeBC7Block(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, uint8_t* block);
+
+	// Compresses every face and level of R8, RG8 or RGBA8 levels, the blocks are encoded in parallel.
+	// internalFormat is one of the BC1, RGTC or BPTC unorm formats, false for anything else.
+	bool compressLevels(const TextureLevels& source, GLenum internalFormat, TextureLevels& target);
+
+	// Encodes again the blocks of a level of target covering a region of the same level of source,
+	// target being compressed from source by compressLevels. Only the first face is updated.
+	void compressRegion(const TextureLevels& source, int mip, int x, int y, int width, int height, TextureLevels& target);
+}
+
+#endif //BCN_H
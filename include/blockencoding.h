@@ -0,0 +1,294 @@
+#ifndef BLOCKENCODING_H
+#define BLOCKENCODING_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "parallel.h"
+#include "simd.h"
+#include "texturelevels.h"
+
+// Building blocks of the BCn and BC6H encoders. A block holds the 16 texels of a 4x4 tile with
+// STRIDE float channels, the endpoint fit only looks at the first CHANNELS of them. Palettes are
+// stored per channel so four entries are compared at once.
+namespace BlockEncoding {
+	// Weight of the second endpoint out of 64 for each 4-bit index, shared by BC6H and BC7
+	const int WEIGHTS_4BIT[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	template<int STRIDE>
+	struct Block
+	{
+		float texels[16][STRIDE];
+	};
+
+	template<int CHANNELS>
+	using Palette = float[CHANNELS][16];
+
+	// Principal axis of the block colors, the endpoints are picked along it
+	template<int CHANNELS, int STRIDE>
+	void fitLine(const Block<STRIDE>& block, float endpoints[2][STRIDE])
+	{
+		float mean[CHANNELS] = {};
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < CHANNELS; ++c) {
+				mean[c] += block.texels[i][c] / 16.0f;
+			}
+		}
+
+		float covariance[CHANNELS][CHANNELS] = {};
+		for (int i = 0; i < 16; ++i) {
+			for (int r = 0; r < CHANNELS; ++r) {
+				for (int c = 0; c < CHANNELS; ++c) {
+					covariance[r][c] += (block.texels[i][r] - mean[r]) * (block.texels[i][c] - mean[c]);
+				}
+			}
+		}
+
+		float axis[CHANNELS];
+		std::fill(axis, axis + CHANNELS, 1.0f);
+
+		for (int iteration = 0; iteration < 8; ++iteration) {
+			float next[CHANNELS] = {};
+			float length = 0.0f;
+
+			for (int r = 0; r < CHANNELS; ++r) {
+				for (int c = 0; c < CHANNELS; ++c) {
+					next[r] += covariance[r][c] * axis[c];
+				}
+
+				length += next[r] * next[r];
+			}
+
+			length = std::sqrt(length);
+
+			// Flat block, any axis works
+			if (length < 1e-6f) {
+				break;
+			}
+
+			for (int c = 0; c < CHANNELS; ++c) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			float projection = 0.0f;
+			for (int c = 0; c < CHANNELS; ++c) {
+				projection += (block.texels[i][c] - mean[c]) * axis[c];
+			}
+
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		for (int c = 0; c < CHANNELS; ++c) {
+			endpoints[0][c] = mean[c] + axis[c] * minProjection;
+			endpoints[1][c] = mean[c] + axis[c] * maxProjection;
+		}
+	}
+
+	// Least squares endpoints for fixed weights of the first endpoint
+	template<int CHANNELS, int STRIDE>
+	bool refineEndpoints(const Block<STRIDE>& block, const float firstWeights[16], float endpoints[2][STRIDE])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[CHANNELS] = {}, bx[CHANNELS] = {};
+
+		for (int t = 0; t < 16; ++t) {
+			float a = firstWeights[t];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+
+			for (int c = 0; c < CHANNELS; ++c) {
+				ax[c] += a * block.texels[t][c];
+				bx[c] += b * block.texels[t][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+
+		if (std::fabs(determinant) < 1e-6f) {
+			return false;
+		}
+
+		for (int c = 0; c < CHANNELS; ++c) {
+			endpoints[0][c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			endpoints[1][c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+
+		return true;
+	}
+
+	// Squared distances from a texel to the first COUNT palette entries, COUNT is a multiple of 4
+	template<int CHANNELS, int COUNT>
+	void paletteErrors(const Palette<CHANNELS>& palette, const float* texel, float* errors)
+	{
+#ifdef PBR_SSE2
+		for (int i = 0; i < COUNT; i += 4) {
+			__m128 error = _mm_setzero_ps();
+
+			for (int c = 0; c < CHANNELS; ++c) {
+				__m128 d = _mm_sub_ps(_mm_loadu_ps(palette[c] + i), _mm_set1_ps(texel[c]));
+				error = _mm_add_ps(error, _mm_mul_ps(d, d));
+			}
+
+			_mm_storeu_ps(errors + i, error);
+		}
+#else
+		for (int i = 0; i < COUNT; ++i) {
+			errors[i] = 0.0f;
+
+			for (int c = 0; c < CHANNELS; ++c) {
+				float d = palette[c][i] - texel[c];
+				errors[i] += d * d;
+			}
+		}
+#endif
+	}
+
+	// Picks the closest palette entry for each texel, comparing the channels from firstChannel
+	// on. Returns the total squared error.
+	template<int CHANNELS, int COUNT, int STRIDE>
+	float selectIndices(const Block<STRIDE>& block, const Palette<CHANNELS>& palette, int firstChannel, int indices[16])
+	{
+		float totalError = 0.0f;
+
+		for (int t = 0; t < 16; ++t) {
+			float errors[16];
+			paletteErrors<CHANNELS, COUNT>(palette, block.texels[t] + firstChannel, errors);
+
+			int best = 0;
+			for (int i = 1; i < COUNT; ++i) {
+				if (errors[i] < errors[best]) {
+					best = i;
+				}
+			}
+
+			indices[t] = best;
+			totalError += errors[best];
+		}
+
+		return totalError;
+	}
+
+	// Endpoints along the principal axis, refined once with least squares and kept only when that
+	// lowers the error. quantize(const float[2][STRIDE], Endpoints&) rounds them to the format,
+	// select(block, const Endpoints&, int[16]) picks the indices and returns the error and
+	// firstWeight(index) is the weight of the first endpoint for an index.
+	template<int CHANNELS, int STRIDE, typename Endpoints, typename Quantize, typename Select, typename FirstWeight>
+	void fitEndpoints(const Block<STRIDE>& block, Endpoints& endpoints, int indices[16], Quantize quantize, Select select, FirstWeight firstWeight)
+	{
+		float fitted[2][STRIDE];
+		fitLine<CHANNELS>(block, fitted);
+		quantize(fitted, endpoints);
+		float error = select(block, endpoints, indices);
+
+		float firstWeights[16];
+		float refined[2][STRIDE];
+
+		for (int t = 0; t < 16; ++t) {
+			firstWeights[t] = firstWeight(indices[t]);
+		}
+
+		if (error > 0.0f && refineEndpoints<CHANNELS>(block, firstWeights, refined)) {
+			Endpoints refinedEndpoints;
+			int refinedIndices[16];
+			quantize(refined, refinedEndpoints);
+
+			if (select(block, refinedEndpoints, refinedIndices) < error) {
+				memcpy(endpoints, refinedEndpoints, sizeof(Endpoints));
+				memcpy(indices, refinedIndices, sizeof(refinedIndices));
+			}
+		}
+	}
+
+	// The anchor index of 4-bit indices is stored without its most significant bit, which must be
+	// 0. Swaps the endpoints and inverts the indices otherwise.
+	template<int CHANNELS>
+	void fixAnchor(int endpoints[2][CHANNELS], int indices[16])
+	{
+		if (indices[0] & 8) {
+			for (int c = 0; c < CHANNELS; ++c) {
+				std::swap(endpoints[0][c], endpoints[1][c]);
+			}
+
+			for (int t = 0; t < 16; ++t) {
+				indices[t] = 15 - indices[t];
+			}
+		}
+	}
+
+	// 128-bit blocks, filled from the least significant bit on
+	struct BitWriter
+	{
+		uint64_t bits[2] = {};
+		int position = 0;
+
+		void write(uint32_t value, int count)
+		{
+			for (int i = 0; i < count; ++i, ++position) {
+				bits[position >> 6] |= static_cast<uint64_t>((value >> i) & 1u) << (position & 63);
+			}
+		}
+
+		// Little endian bit stream
+		void store(uint8_t* block) const
+		{
+			for (int i = 0; i < 16; ++i) {
+				block[i] = static_cast<uint8_t>(bits[i >> 3] >> ((i & 7) * 8));
+			}
+		}
+	};
+
+	// Compresses every face and level of source into target, whose internal format is set already.
+	// encode(pixels, width, height, blockX, blockY, block) encodes a block of a face of a level.
+	// The blocks of all the levels are split evenly over the pool, whatever their level.
+	template<typename Encode>
+	void compressLevels(const TextureLevels& source, TextureLevels& target, Encode encode)
+	{
+		target.width = source.width;
+		target.height = source.height;
+		target.faces = source.faces;
+		target.mipLevels = source.mipLevels;
+		target.data.resize(target.totalSize());
+
+		// Block offsets of every level
+		std::vector<size_t> levelBlocks(source.mipLevels + 1, 0);
+
+		for (int mip = 0; mip < source.mipLevels; ++mip) {
+			size_t blocksX = (std::max(1, source.width >> mip) + 3) / 4;
+			size_t blocksY = (std::max(1, source.height >> mip) + 3) / 4;
+			levelBlocks[mip + 1] = levelBlocks[mip] + blocksX * blocksY * source.faces;
+		}
+
+		parallelFor(levelBlocks.back(), [&](size_t begin, size_t end) {
+			int mip = 0;
+
+			for (size_t i = begin; i < end; ++i) {
+				while (i >= levelBlocks[mip + 1]) {
+					++mip;
+				}
+
+				int mipWidth = std::max(1, source.width >> mip);
+				int mipHeight = std::max(1, source.height >> mip);
+				size_t blocksX = (mipWidth + 3) / 4;
+				size_t faceBlocks = blocksX * ((mipHeight + 3) / 4);
+				size_t block = i - levelBlocks[mip];
+				int face = static_cast<int>(block / faceBlocks);
+				size_t faceBlock = block % faceBlocks;
+
+				uint8_t* output = reinterpret_cast<uint8_t*>(target.faceData(mip, face)) + faceBlock * target.bytesPerPixel;
+				encode(source.faceData(mip, face), mipWidth, mipHeight, static_cast<int>(faceBlock % blocksX), static_cast<int>(faceBlock / blocksX), output);
+			}
+		});
+	}
+}
+
+#endif //BLOCKENCODING_H
@@ -0,0 +1,16 @@
+#ifndef BRDFLUT_H
+#define BRDFLUT_H
+
+#include <cstdint>
+#include <vector>
+
+namespace BrdfLUT {
+	const int RESOLUTION = 512;
+	const unsigned int SAMPLE_COUNT = 1024;
+
+	// Split-sum environment BRDF, x = NdotV and y = roughness.
+	// Returns resolution^2 RG pairs as half floats, row 0 being roughness 0.
+	std::vector<uint16_t> integrate(int resolution);
+}
+
+#endif //BRDFLUT_H
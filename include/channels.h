@@ -0,0 +1,12 @@
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Channels {
+	// Keeps the first channels (1 or 2) of each RGBA8 texel, output holds texelCount * channels bytes
+	void extract(const uint8_t* rgba, size_t texelCount, int channels, uint8_t* output);
+}
+
+#endif //CHANNELS_H
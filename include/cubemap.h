@@ -2,6 +2,7 @@
 #define CUBEMAP_H
 
 #include <glad/glad.h>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -15,7 +16,8 @@ public:
 	CubeMap(const CubeMap &) = delete;
 	CubeMap &operator=(const CubeMap &) = delete;
 
-	CubeMap(CubeMap &&other) : mID(other.mID)
+	CubeMap(CubeMap &&other) : mID(other.mID), mCacheKey(std::move(other.mCacheKey)),
+		mFirstBakedLevel(other.mFirstBakedLevel), mLastBakedLevel(other.mLastBakedLevel)
 	{
 		other.mID = 0; //Use the "null" texture for the old object.
 	}
@@ -28,14 +30,30 @@ public:
 			release();
 			//ID is now 0.
 			std::swap(mID, other.mID);
+			mCacheKey = std::move(other.mCacheKey);
+			mFirstBakedLevel = other.mFirstBakedLevel;
+			mLastBakedLevel = other.mLastBakedLevel;
 		}
+
+		return *this;
 	}
 
 	GLuint getId() const;
 	void bind(GLenum textureUnit) const;
+	const std::string& getCacheKey() const;
+	void setCacheKey(const std::string& cacheKey);
+
+	// Mips holding baked content, sampling is clamped to them. Every mip until set.
+	void setBakedLevels(int firstLevel, int lastLevel);
+	int getFirstBakedLevel() const;
+	int getLastBakedLevel() const;
+	bool hasBakedLevels(int firstLevel, int lastLevel) const;
 
 private:
 	GLuint mID = 0;
+	std::string mCacheKey; // Identifies the baked content in the BakeCache
+	int mFirstBakedLevel = 0;
+	int mLastBakedLevel = std::numeric_limits<int>::max();
 
 	void release();
 };
@@ -1,26 +1,71 @@
 #ifndef CUBEMAPGENERATOR_H
 #define CUBEMAPGENERATOR_H
 
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 #include <glad\glad.h>
+#include "bakecache.h"
 #include "cubemap.h"
+#include "iblbaker.h"
+#include "iblquality.h"
+#include "mappedfile.h"
+#include "prefiltersamples.h"
+#include "shader.h"
 #include "texture.h"
-#include "quad.h"
 #include "skybox.h"
+#include "sphericalharmonics.h"
 
+// GPU passes of the IBL bake. They're kept small so a bake can be spread over several frames,
+// see EnvironmentBake for the ordering.
 class CubeMapGenerator
 {
 public:
 	CubeMapGenerator();
 	~CubeMapGenerator();
-	std::shared_ptr<CubeMap> generateEnvironmentMap(const GLchar* imagePath);
-	std::shared_ptr<CubeMap> generateIrradianceMap(const std::shared_ptr<CubeMap> environmentMap);
-	std::shared_ptr<CubeMap> generatePreFilterMap(const std::shared_ptr<CubeMap> environmentMap);
+
+	// CPU side, safe to call from any thread
+	static std::string sourceCacheKey(const MappedFile& imageFile);
+	static std::string environmentCacheKey(const std::string& sourceKey, const IblQuality::Settings& settings);
+	static std::string preFilterCacheKey(const std::string& environmentKey, const IblQuality::Settings& settings);
+
+	std::shared_ptr<CubeMap> createCubeMap(GLenum internalFormat, int resolution, int mipLevels) const;
+
+	std::shared_ptr<CubeMap> createEnvironmentMap(const IblQuality::Settings& settings) const;
+	void uploadEquirectangular(const EquirectangularImage& image);
+	void renderEnvironmentFace(const IblQuality::Settings& settings, const CubeMap& environmentMap, int face);
+	void finishEnvironmentMap(const CubeMap& environmentMap);
+
+	std::shared_ptr<SphericalHarmonics> generateIrradianceSH(const IblQuality::Settings& settings, const std::shared_ptr<CubeMap> environmentMap);
+
+	std::shared_ptr<CubeMap> createPreFilterMap(const IblQuality::Settings& settings) const;
+	void renderPreFilterFace(const IblQuality::Settings& settings, const std::shared_ptr<CubeMap> environmentMap, const CubeMap& preFilterMap, int mip, int face);
+
+	// Copies a level rendered in IblQuality::renderFormat into its storage format
+	void packLevel(const CubeMap& source, const CubeMap& target, GLenum internalFormat, int resolution, int mip, int face);
+
 	std::shared_ptr<Texture> generateBrdfLUT();
 
+	const BakeCache& getBakeCache() const;
+
 private:
-	std::unique_ptr<Quad> mQuad = nullptr;
 	std::unique_ptr<Skybox> mSkybox = nullptr;
+	std::unique_ptr<Shader> mEquirectangularShader = nullptr;
+	std::unique_ptr<Shader> mPreFilterShader = nullptr;
+	BakeCache mBakeCache;
+
+	GLuint mCaptureFBO = 0;
+	GLuint mHdrTextureID = 0;
+	GLuint mSamplesUBO = 0;
+
+	// Sample tables of the settings they were generated for
+	std::vector<PrefilterSamples::Table> mSampleTables;
+	int mSampleTablesEnvironmentResolution = 0;
+	int mSampleTablesPreFilterResolution = 0;
+	int mBoundSampleMip = -1;
+
+	void updateSampleTables(const IblQuality::Settings& settings);
 };
 
-#endif//CUBEMAPGENERATOR_H
\ No newline at end of file
+#endif//CUBEMAPGENERATOR_H
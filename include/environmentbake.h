@@ -0,0 +1,130 @@
+#ifndef ENVIRONMENTBAKE_H
+#define ENVIRONMENTBAKE_H
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bakecache.h"
+#include "cubemap.h"
+#include "cubemapgenerator.h"
+#include "iblquality.h"
+#include "sphericalharmonics.h"
+
+// Bakes the IBL maps of an HDR environment without blocking the render loop. The file is read,
+// hashed and decoded (or fetched from the bake cache) on a worker thread, the GPU passes are then
+// split in per-face and per-mip slices which update() runs until its time budget is spent. The GPU
+// time of the slices is measured with timer queries read back on a later update, so the budget
+// covers it without stalling on the GPU.
+// The results are only handed out once every map is complete. Maps of the current environment
+// whose settings didn't change are reused as is. Containers written by pbr_bake are uploaded
+// directly with the settings they were baked with.
+// Only the prefilter mips a material of the given roughness range samples are rendered (see
+// IblQuality::preFilterLevels), the others are left out of sampling. Baking the same environment
+// again with a wider range renders the missing mips into the current map. Prefilter maps are only
+// packed and stored in the bake cache once every mip is rendered.
+class EnvironmentBake
+{
+public:
+	EnvironmentBake(CubeMapGenerator& generator, const std::string& imagePath, const IblQuality::Settings& settings,
+		std::shared_ptr<CubeMap> currentEnvironmentMap = nullptr, std::shared_ptr<SphericalHarmonics> currentIrradianceSH = nullptr,
+		std::shared_ptr<CubeMap> currentPreFilterMap = nullptr, const glm::vec2& roughnessRange = glm::vec2(0.0f, 1.0f));
+	// Waits for the worker threads, an abandoned decode stops before decoding the image
+	~EnvironmentBake();
+
+	//Delete the copy constructor/assignment.
+	EnvironmentBake(const EnvironmentBake &) = delete;
+	EnvironmentBake &operator=(const EnvironmentBake &) = delete;
+
+	// Returns true once the bake is over, successfully or not
+	bool update(double budgetMs);
+	void finish();
+
+	bool succeeded() const;
+	float getProgress() const;
+	const std::string& getImagePath() const;
+	const IblQuality::Settings& getSettings() const;
+
+	std::shared_ptr<CubeMap> getEnvironmentMap() const;
+	std::shared_ptr<SphericalHarmonics> getIrradianceSH() const;
+	std::shared_ptr<CubeMap> getPreFilterMap() const;
+
+private:
+	// Written by the worker thread until done is set
+	struct DecodeState
+	{
+		std::atomic<bool> done{ false };
+		std::atomic<bool> cancelled{ false };
+		bool succeeded = false;
+		IblQuality::Settings settings;
+		std::string environmentKey;
+		std::string preFilterKey;
+		EquirectangularImage image;
+		// Cached and container levels are mapped, the files stay open until they are uploaded
+		MappedFile imageFile;
+		MappedFile environmentFile;
+		MappedFile preFilterFile;
+		BakeCache::Levels environmentLevels;
+		BakeCache::Levels preFilterLevels;
+		std::vector<char> shData;
+		bool environmentReused = false;
+		bool preFilterReused = false;
+		bool environmentCached = false;
+		bool preFilterCached = false;
+		bool shCached = false;
+	};
+
+	CubeMapGenerator& mGenerator;
+	std::string mImagePath;
+	IblQuality::Settings mSettings;
+	glm::vec2 mRoughnessRange;
+	std::shared_ptr<DecodeState> mDecodeState;
+	// Slices return false while they wait on a worker thread
+	std::deque<std::function<bool()>> mSlices;
+	size_t mSliceCount = 0;
+	bool mScheduled = false;
+	bool mDone = false;
+	bool mSucceeded = false;
+	// Decode, compression and cache store threads, joined by the destructor
+	std::vector<std::thread> mWorkers;
+
+	// Each query times the slices of one update, it is read once available
+	static const int TIMER_QUERIES = 3;
+	GLuint mTimerQueries[TIMER_QUERIES] = {};
+	size_t mTimedSlices[TIMER_QUERIES] = {};
+	int mTimerQuery = 0;
+	// Average GPU time of a slice, negative until the first query is read
+	double mSliceGpuMs = -1.0;
+
+	std::shared_ptr<CubeMap> mEnvironmentMap = nullptr;
+	std::shared_ptr<SphericalHarmonics> mIrradianceSH = nullptr;
+	std::shared_ptr<CubeMap> mPreFilterMap = nullptr;
+
+	// Storage format maps being filled from the render format ones
+	std::shared_ptr<CubeMap> mEnvironmentTarget = nullptr;
+	std::shared_ptr<CubeMap> mPreFilterTarget = nullptr;
+
+	// Prefilter mips baked once done, and those the reused map already held (none if last < first)
+	glm::ivec2 mPreFilterLevels = glm::ivec2(0, -1);
+	glm::ivec2 mReusedPreFilterLevels = glm::ivec2(0, -1);
+
+	bool rendersPreFilter() const;
+	bool completesPreFilter() const;
+	void schedule();
+	void schedulePacking();
+	void scheduleConversion(std::shared_ptr<CubeMap>& map, std::shared_ptr<CubeMap>& target, GLenum format, int resolution, int mipLevels);
+	void scheduleEnvironment();
+	void scheduleIrradiance();
+	void schedulePreFilter();
+	void scheduleCacheStore();
+	void addSlice(std::function<void()> slice);
+	void addWait(std::function<bool()> ready);
+	void startWorker(std::function<void()> work);
+	void readTimerQueries();
+};
+
+#endif //ENVIRONMENTBAKE_H
@@ -0,0 +1,24 @@
+#ifndef FILES_H
+#define FILES_H
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <string>
+
+// File helpers shared by the writers of baked and packed files
+namespace Files {
+	// Written files are renamed from a temporary file with this extension in the same directory
+	const char* const TEMPORARY_EXTENSION = ".tmp";
+
+	// Case-insensitive, extension includes its dot
+	bool hasExtension(const std::string& path, const char* extension);
+
+	// Writes a temporary file then renames it over path, so a crash can't leave a truncated file
+	// behind. Every call gets its own temporary file, concurrent writers of a path don't clash.
+	// write returns false to give up, the temporary file is then removed.
+	bool writeAtomic(const std::string& path, const std::function<bool(std::ofstream& file)>& write);
+	bool writeAtomic(const std::string& path, const void* data, size_t size);
+}
+
+#endif //FILES_H
@@ -0,0 +1,60 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reports the files of a set that changed on disk, from a thread waiting on change notifications
+// of their directories. Directories are watched rather than files, editors often save to a new
+// file renamed over the old one. A file counts as changed once its modification time or size
+// differs from the last time it was seen, and the directory stayed quiet for a moment so
+// partially written files aren't reported.
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	//Delete the copy constructor/assignment.
+	FileWatcher(const FileWatcher &) = delete;
+	FileWatcher &operator=(const FileWatcher &) = delete;
+
+	// Replaces the watched files, returns without allocating when the set is unchanged. The paths
+	// are expected to be distinct. Files missing from the disk, embedded resources among them,
+	// are reported once they appear.
+	void setPaths(const std::vector<std::string>& paths);
+
+	// Files changed since the last call
+	std::vector<std::string> takeChanged();
+
+private:
+	struct Version
+	{
+		int64_t modificationTime = 0;
+		uintmax_t size = 0;
+	};
+
+	std::thread mThread;
+	std::mutex mMutex;
+	std::map<std::string, Version> mFiles;
+	std::vector<std::string> mChanged;
+	bool mPathsChanged = false;
+	bool mStopping = false;
+#ifdef _WIN32
+	void* mWakeEvent = nullptr;
+#else
+	int mWakeFile = -1;
+#endif
+
+	static Version version(const std::string& path);
+	std::vector<std::string> directories();
+	void scan();
+	void wake();
+	void watchLoop();
+};
+
+#endif //FILEWATCHER_H
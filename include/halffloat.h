@@ -0,0 +1,99 @@
+#ifndef HALFFLOAT_H
+#define HALFFLOAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace HalfFloat {
+	// IEEE 754 binary16 from binary32, round to nearest even
+	inline uint16_t fromFloat(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000u;
+		uint32_t exponent = (bits >> 23) & 0xFFu;
+		uint32_t mantissa = bits & 0x7FFFFFu;
+
+		// NaN and infinity
+		if (exponent == 0xFFu) {
+			return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+		}
+
+		int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+		// Overflow to infinity
+		if (halfExponent >= 0x1F) {
+			return static_cast<uint16_t>(sign | 0x7C00u);
+		}
+
+		// Denormals and underflow to zero
+		if (halfExponent <= 0) {
+			if (halfExponent < -10) {
+				return static_cast<uint16_t>(sign);
+			}
+
+			mantissa |= 0x800000u;
+			uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+			uint32_t halfMantissa = mantissa >> shift;
+			uint32_t remainder = mantissa & ((1u << shift) - 1u);
+			uint32_t halfway = 1u << (shift - 1);
+
+			if (remainder > halfway || (remainder == halfway && (halfMantissa & 1u))) {
+				halfMantissa++;
+			}
+
+			return static_cast<uint16_t>(sign | halfMantissa);
+		}
+
+		uint32_t half = sign | (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+		uint32_t remainder = mantissa & 0x1FFFu;
+
+		// A carry into the exponent is still the correctly rounded result
+		if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+			half++;
+		}
+
+		return static_cast<uint16_t>(half);
+	}
+
+	inline float toFloat(uint16_t half)
+	{
+		uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+		uint32_t exponent = (half >> 10) & 0x1Fu;
+		uint32_t mantissa = half & 0x3FFu;
+		uint32_t bits;
+
+		if (exponent == 0x1Fu) {
+			bits = sign | 0x7F800000u | (mantissa << 13);
+		}
+		else if (exponent != 0) {
+			bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+		}
+		else if (mantissa != 0) {
+			// Renormalize the denormal
+			exponent = 127 - 15 + 1;
+
+			while ((mantissa & 0x400u) == 0) {
+				mantissa <<= 1;
+				exponent--;
+			}
+
+			bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+		}
+		else {
+			bits = sign;
+		}
+
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Bulk conversion, F16C when the build has it. Values outside the half range saturate to the
+	// largest finite half so bright HDR texels can't turn into infinities.
+	void fromFloats(const float* values, uint16_t* halves, size_t count);
+}
+
+#endif //HALFFLOAT_H
@@ -0,0 +1,39 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Hash {
+	const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	const uint64_t FNV_PRIME = 1099511628211ull;
+
+	// 64-bit FNV-1a, pass a previous result as seed to chain several inputs
+	inline uint64_t fnv1a(const void* data, size_t size, uint64_t seed = FNV_OFFSET)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = seed;
+
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * FNV_PRIME;
+		}
+
+		return hash;
+	}
+
+	inline std::string toHex(uint64_t hash)
+	{
+		const char digits[] = "0123456789abcdef";
+		std::string hex(16, '0');
+
+		for (int i = 15; i >= 0; --i) {
+			hex[i] = digits[hash & 0xF];
+			hash >>= 4;
+		}
+
+		return hex;
+	}
+}
+
+#endif //HASH_H
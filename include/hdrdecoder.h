@@ -0,0 +1,24 @@
+#ifndef HDRDECODER_H
+#define HDRDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Radiance .hdr (RGBE) reader. Scanline offsets are located with a quick pass over the run
+// lengths, the scanlines are then decoded in parallel straight into the destination buffer.
+namespace HdrDecoder {
+	struct Header
+	{
+		int width = 0;
+		int height = 0;
+		size_t dataOffset = 0;
+	};
+
+	// Fails on anything but a standard "-Y height +X width" image
+	bool readHeader(const char* data, size_t size, Header& header);
+
+	// RGB half floats, bottom row first as GL expects
+	bool decode(const char* data, size_t size, const Header& header, uint16_t* rgb);
+}
+
+#endif //HDRDECODER_H
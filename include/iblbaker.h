@@ -0,0 +1,54 @@
+#ifndef IBLBAKER_H
+#define IBLBAKER_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "iblcontainer.h"
+#include "iblquality.h"
+#include "mappedfile.h"
+#include "shprojection.h"
+#include "texturelevels.h"
+
+// Equirectangular HDR pixels, RGB half floats with the bottom row first as GL expects
+struct EquirectangularImage
+{
+	int width = 0;
+	int height = 0;
+	std::vector<uint16_t> pixels;
+};
+
+// CPU side of the IBL bake. pbr_bake runs the whole bake here without a GL context, it mirrors
+// the passes of CubeMapGenerator: same face layout, equirectangular mapping and prefilter sample
+// tables. Lookups don't blend across cube faces, unlike GL_TEXTURE_CUBE_MAP_SEAMLESS.
+// Everything is safe to call from any thread.
+namespace IblBaker {
+	// RGB float texels, the 6 faces of a level one after the other
+	struct CubeMapLevels
+	{
+		int resolution = 0;
+		std::vector<std::vector<float>> levels;
+
+		int mipLevels() const;
+		int levelResolution(int mip) const;
+		const float* faceData(int mip, int face) const;
+		float* faceData(int mip, int face);
+	};
+
+	bool decodeEquirectangular(const MappedFile& imageFile, EquirectangularImage& image);
+
+	// Equivalent of the equirectangular pass followed by glGenerateMipmap
+	CubeMapLevels renderEnvironment(const EquirectangularImage& image, int resolution, int mipLevels);
+	SHProjection::Coefficients projectIrradiance(const CubeMapLevels& environment);
+	CubeMapLevels preFilter(const CubeMapLevels& environment, int resolution, int mipLevels);
+
+	// Converts float levels to a storage format, false if it isn't supported
+	bool storeLevels(const CubeMapLevels& cubeMap, GLenum internalFormat, TextureLevels& levels);
+
+	// Block compresses RGB half float levels, every block of every level is encoded in parallel
+	void compressLevels(const TextureLevels& source, GLenum internalFormat, TextureLevels& target);
+
+	bool bake(const MappedFile& imageFile, const IblQuality::Settings& settings, IblContainer::Contents& contents);
+}
+
+#endif //IBLBAKER_H
@@ -0,0 +1,32 @@
+#ifndef IBLCONTAINER_H
+#define IBLCONTAINER_H
+
+#include <cstddef>
+#include <string>
+#include "iblquality.h"
+#include "shprojection.h"
+#include "texturelevels.h"
+
+// Pre-baked IBL maps of one environment, written by pbr_bake. The viewer loads a container like
+// an HDR image, its levels are uploaded as they are. Layout: a small header with the irradiance
+// SH, then the environment and prefilter levels as BakeCache blobs.
+namespace IblContainer {
+	const char* const EXTENSION = ".ibl";
+
+	struct Contents
+	{
+		TextureLevels environment;
+		TextureLevels preFilter;
+		SHProjection::Coefficients irradianceSH;
+	};
+
+	bool isContainer(const std::string& path);
+	// The levels point into data, which must outlive them
+	bool read(const char* data, size_t size, Contents& contents);
+	bool write(const std::string& path, const Contents& contents);
+
+	// Settings the container was baked with
+	IblQuality::Settings settings(const Contents& contents);
+}
+
+#endif //IBLCONTAINER_H
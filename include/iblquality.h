@@ -0,0 +1,43 @@
+#ifndef IBLQUALITY_H
+#define IBLQUALITY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+
+// Resolution, mip count and storage format of the baked IBL maps, from full precision down to
+// packed formats that fit several environments in the VRAM of lower-end GPUs.
+namespace IblQuality {
+	enum Tier { LOW, MEDIUM, HIGH_COMPRESSED, HIGH };
+
+	struct Settings
+	{
+		int environmentResolution;
+		int environmentMipLevels;
+		GLenum environmentFormat;
+		int preFilterResolution;
+		int preFilterMipLevels;
+		GLenum preFilterFormat;
+	};
+
+	const Settings& settings(Tier tier);
+
+	// HIGH_COMPRESSED falls back to HIGH without BPTC support
+	Tier supportedTier(Tier tier, bool bptcSupported);
+
+	// Shared exponent and BC6H aren't color renderable, such maps are rendered in RGB16F and
+	// packed or compressed afterwards
+	GLenum renderFormat(GLenum storageFormat);
+	bool isCompressed(GLenum format);
+
+	// Nominal sizes, drivers may pad RGB16F texels to 8 bytes
+	size_t bytesPerTexel(GLenum format);
+	size_t cubeMapSize(GLenum format, int resolution, int mipLevels);
+	size_t memorySize(const Settings& settings);
+
+	// First and last prefilter mips sampled by materials whose roughness spans the range. The
+	// PBR shader reads roughness * MAX_REFLECTION_LOD, trilinear filtering both mips around it.
+	glm::ivec2 preFilterLevels(const Settings& settings, const glm::vec2& roughnessRange);
+}
+
+#endif //IBLQUALITY_H
@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a file's content. Files on disk are memory mapped, embedded resources are
+// referenced in place, either way nothing is copied.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	//Delete the copy constructor/assignment.
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool open(const std::string& path);
+	void assign(const char* data, size_t size);
+	void close();
+
+	bool isOpen() const;
+	const char* data() const;
+	size_t size() const;
+
+private:
+	const char* mData = nullptr;
+	size_t mSize = 0;
+	bool mMapped = false;
+#ifdef _WIN32
+	void* mFileHandle = nullptr;
+	void* mMappingHandle = nullptr;
+#endif
+};
+
+#endif //MAPPEDFILE_H
@@ -2,31 +2,66 @@
 #define MATERIAL_H
 
 #include <memory>
+#include <string>
+#include <vector>
 #include "texture.h"
 #include "cubemap.h"
 #include "shader.h"
+#include "uniformbuffer.h"
+#include "virtualtexture.h"
 
 class Material
 {
 public:
+	// Shader variant flags, each one adds the define of the same name (see shaderDefines)
+	enum ShaderVariant
+	{
+		VIRTUAL_ALBEDO = 1 << 0,
+		PACKED_ORM = 1 << 1,
+		CONSTANT_ALBEDO = 1 << 2,
+		CONSTANT_NORMAL = 1 << 3,
+		CONSTANT_ORM = 1 << 4,
+		CONSTANT_METALLIC = 1 << 5,
+		CONSTANT_ROUGHNESS = 1 << 6,
+		CONSTANT_AO = 1 << 7,
+		CONSTANT_DISPLACEMENT = 1 << 8
+	};
+
 	Material();
 	void use(const Shader& shader, unsigned int &textureUnit) const;
+	// Flags of the shader variant matching the maps: PACKED_ORM, VIRTUAL_ALBEDO, and a
+	// CONSTANT_<MAP> for each constant map, read from its <map>Value in the MaterialData block
+	unsigned int shaderVariant() const;
+	// Defines of a variant, built once when it's compiled (see ShaderVariants)
+	static std::vector<std::string> shaderDefines(unsigned int variant);
+	// Roughness values the material can sample, from its map statistics. [0, 1] until loaded.
+	glm::vec2 getRoughnessRange() const;
 	void setAlbedoMap(std::shared_ptr<Texture> albedoMap);
+	// Used instead of the albedo map when set, needs the VIRTUAL_ALBEDO shader variant
+	void setVirtualAlbedoMap(std::shared_ptr<VirtualTexture> virtualAlbedoMap);
+	bool hasVirtualAlbedoMap() const;
 	void setNormalMap(std::shared_ptr<Texture> normalMap);
 	void setMetallicMap(std::shared_ptr<Texture> metallicMap);
 	void setRoughnessMap(std::shared_ptr<Texture> roughnessMap);
 	void setAoMap(std::shared_ptr<Texture> aoMap);
+	// Replaces the metallic, roughness and AO maps, needs the PACKED_ORM shader variant
+	void setOrmMap(std::shared_ptr<Texture> ormMap);
+	bool hasOrmMap() const;
 	void setDisplacementMap(std::shared_ptr<Texture> displacementMap);
 	void setTextureScale(float scaleX, float scaleY);
 
 private:
 	std::shared_ptr<Texture> mAlbedoMap = nullptr;
+	std::shared_ptr<VirtualTexture> mVirtualAlbedoMap = nullptr;
 	std::shared_ptr<Texture> mNormalMap = nullptr;
 	std::shared_ptr<Texture> mMetallicMap = nullptr;
 	std::shared_ptr<Texture> mRoughnessMap = nullptr;
 	std::shared_ptr<Texture> mAoMap = nullptr;
+	std::shared_ptr<Texture> mOrmMap = nullptr;
 	std::shared_ptr<Texture> mDisplacementMap = nullptr;
 	glm::vec2 mTextureScale = glm::vec2(1.0f, 1.0f);
+	// MaterialData block, written by use() when the constants or the scale change
+	mutable UniformBuffer mMaterialUniforms;
 };
 
 #endif//MATERIAL_H
\ No newline at end of file
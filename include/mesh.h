@@ -5,6 +5,7 @@
 #include <vector>
 #include "material.h"
 #include "shader.h"
+#include "uniformbuffer.h"
 
 
 struct Vertex {
@@ -20,10 +21,13 @@ public:
 	Mesh();
 	virtual ~Mesh() = 0;
 	virtual void draw(const Shader& shader) const;
+	// Fills the ObjectData block the mesh binds when drawn, written only when it changes
+	void setTransform(const glm::mat4& model, float displacementAmount = 0.0f);
 
 private:
 	unsigned int mVAO, mVBO, mEBO;
 	int mIndexCount = 0;
+	UniformBuffer mObjectUniforms;
 
 protected:
 	GLenum mPrimitive = GL_TRIANGLES;
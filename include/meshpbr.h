@@ -3,6 +3,7 @@
 
 #include "mesh.h"
 #include "material.h"
+#include "sphericalharmonics.h"
 
 class MeshPBR : public Mesh
 {
@@ -10,24 +11,30 @@ public:
 	MeshPBR();
 	virtual ~MeshPBR() = 0;
 	void draw(const Shader& shader) const override;
+	unsigned int shaderVariant() const;
+	glm::vec2 getRoughnessRange() const;
 
 	void setAlbedoMap(std::shared_ptr<Texture> albedoMap);
+	void setVirtualAlbedoMap(std::shared_ptr<VirtualTexture> virtualAlbedoMap);
+	bool hasVirtualAlbedoMap() const;
 	void setNormalMap(std::shared_ptr<Texture> normalMap);
 	void setMetallicMap(std::shared_ptr<Texture> metallicMap);
 	void setRoughnessMap(std::shared_ptr<Texture> roughnessMap);
 	void setAoMap(std::shared_ptr<Texture> aoMap);
+	void setOrmMap(std::shared_ptr<Texture> ormMap);
+	bool hasOrmMap() const;
 	void setDisplacementMap(std::shared_ptr<Texture> displacementMap);
 	void setTextureScale(float scaleX, float scaleY);
 
 	void setBrdfLUT(std::shared_ptr<Texture> brdfLUT);
-	void setIrradianceMap(std::shared_ptr<CubeMap> irradianceMap);
+	void setIrradianceSH(std::shared_ptr<SphericalHarmonics> irradianceSH);
 	void setPreFilterMap(std::shared_ptr<CubeMap> preFilterMap);
 
 private:
 	Material mMaterial;
 
 	std::shared_ptr<Texture> mBrdfLUT;
-	std::shared_ptr<CubeMap> mIrradianceMap;
+	std::shared_ptr<SphericalHarmonics> mIrradianceSH;
 	std::shared_ptr<CubeMap> mPreFilterMap;
 };
 
@@ -0,0 +1,37 @@
+#ifndef MIPGENERATOR_H
+#define MIPGENERATOR_H
+
+#include <vector>
+#include "texturelevels.h"
+
+// CPU replacement for glGenerateMipmap on 8 and 16-bit unorm textures. Each level is filtered from
+// the previous one in linear float, sRGB colors are linearized first and encoded back per level,
+// alpha is always linear. Rows of a level are filtered in parallel, the result doesn't depend on
+// the driver.
+namespace MipGenerator {
+	enum Filter { BOX, KAISER, LANCZOS };
+
+	// Rectangle of texels in a level
+	struct Region
+	{
+		int x = 0;
+		int y = 0;
+		int width = 0;
+		int height = 0;
+
+		bool isEmpty() const { return width <= 0 || height <= 0; }
+	};
+
+	int mipLevelCount(int width, int height);
+
+	// Returns every level of the image. internalFormat is GL_R8, GL_RG8, GL_RGBA8, GL_SRGB8_ALPHA8
+	// or GL_R16 and gives the layout of pixels. Texels wrap around the edges like the GL_REPEAT
+	// material textures.
+	TextureLevels generate(const void* pixels, int width, int height, GLenum internalFormat, Filter filter);
+
+	// Filters again the texels of the smaller levels that depend on region of level 0, after it
+	// was changed in place. Returns the region updated in each level, all of level 0 included.
+	std::vector<Region> update(TextureLevels& levels, const Region& region, Filter filter);
+}
+
+#endif //MIPGENERATOR_H
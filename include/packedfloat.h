@@ -0,0 +1,35 @@
+#ifndef PACKEDFLOAT_H
+#define PACKEDFLOAT_H
+
+#include <algorithm>
+#include <cstdint>
+#include "halffloat.h"
+
+namespace PackedFloat {
+	// Unsigned float with the half float exponent and a shorter mantissa, as used by GL_R11F_G11F_B10F
+	inline uint32_t toUnsigned(float value, int mantissaBits)
+	{
+		// Negative and NaN components clamp to zero
+		if (!(value > 0.0f)) {
+			return 0;
+		}
+
+		const uint32_t maxFinite = (30u << mantissaBits) | ((1u << mantissaBits) - 1u);
+		uint32_t half = HalfFloat::fromFloat(value);
+
+		if ((half & 0x7C00u) == 0x7C00u) {
+			return maxFinite;
+		}
+
+		int shift = 10 - mantissaBits;
+		return std::min((half + (1u << (shift - 1))) >> shift, maxFinite);
+	}
+
+	// GL_R11F_G11F_B10F texel in the GL_UNSIGNED_INT_10F_11F_11F_REV layout
+	inline uint32_t fromRGB(float r, float g, float b)
+	{
+		return toUnsigned(r, 6) | (toUnsigned(g, 6) << 11) | (toUnsigned(b, 5) << 22);
+	}
+}
+
+#endif //PACKEDFLOAT_H
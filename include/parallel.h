@@ -0,0 +1,28 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Splits [0, count) into contiguous ranges and runs them on a pool of one thread per hardware
+// thread, created on first use. The calling thread takes ranges too. Nested calls from the pool
+// threads share the same pool, a thread waiting on its ranges runs queued ones meanwhile.
+void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body);
+
+// Marks the calling thread as a worker of another pool for its lifetime, parallelFor calls then
+// run inline on it. Those pools keep every core busy already, nesting would only oversubscribe.
+class ParallelRegion
+{
+public:
+	ParallelRegion();
+	~ParallelRegion();
+
+	//Delete the copy constructor/assignment.
+	ParallelRegion(const ParallelRegion &) = delete;
+	ParallelRegion &operator=(const ParallelRegion &) = delete;
+
+private:
+	bool mWasInside;
+};
+
+#endif //PARALLEL_H
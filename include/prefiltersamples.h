@@ -0,0 +1,29 @@
+#ifndef PREFILTERSAMPLES_H
+#define PREFILTERSAMPLES_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// GGX importance samples for the prefiltered environment map. With V = N = R the sample
+// directions only depend on the roughness, so they're computed once per mip on the CPU.
+namespace PrefilterSamples {
+	// Must match MAX_SAMPLES in shaderprefilter.fs
+	const unsigned int MAX_SAMPLES = 512;
+
+	struct Table
+	{
+		// Tangent space light directions (z is NdotL) and the environment lod to sample in w.
+		// Samples below the horizon are already dropped.
+		std::vector<glm::vec4> samples;
+		float totalWeight = 0.0f;
+	};
+
+	// Samples used for a roughness mip, 0 for mip 0 which is a plain copy of the environment
+	unsigned int sampleCount(unsigned int mip);
+	Table generate(float roughness, unsigned int sampleCount, int envRes);
+
+	// Tables of every prefilter mip, mip 0 being a single sample copy of the environment mip of the same size
+	std::vector<Table> generateMips(int mipLevels, int envRes, int preFilterRes);
+}
+
+#endif //PREFILTERSAMPLES_H
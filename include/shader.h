@@ -3,24 +3,66 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
+// Uniform or uniform block name hashed with FNV-1a, literals passed to the setters are hashed by the
+// compiler. Appending a suffix continues the hash, so a name built from parts matches the whole
+// string without ever building it.
+class UniformName
+{
+public:
+	constexpr UniformName(const char* name) : mHash(hash(OFFSET_BASIS, name)) {}
+	UniformName(const std::string& name) : UniformName(name.c_str()) {}
+
+	constexpr UniformName operator+(const char* suffix) const
+	{
+		return UniformName(hash(mHash, suffix));
+	}
+
+	constexpr uint32_t getHash() const
+	{
+		return mHash;
+	}
+
+private:
+	static constexpr uint32_t OFFSET_BASIS = 2166136261u;
+	static constexpr uint32_t PRIME = 16777619u;
+
+	uint32_t mHash;
 
+	constexpr explicit UniformName(uint32_t hash) : mHash(hash) {}
+
+	static constexpr uint32_t hash(uint32_t value, const char* text)
+	{
+		for (; *text; ++text) {
+			value = (value ^ static_cast<uint8_t>(*text)) * PRIME;
+		}
+
+		return value;
+	}
+};
+
+// Uniform locations and block indices are resolved once after linking into tables sorted by name
+// hash, so setting a uniform neither queries the driver nor allocates.
 class Shader
 {
 public:
 
-	Shader(const GLchar* vertexPath, const GLchar* fragmentPath);
+	// The defines are inserted after the #version line of both stages, to build shader variants
+	Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const std::vector<std::string>& defines = {});
 	~Shader();
 
 	//Delete the copy constructor/assignment.
 	Shader(const Shader &) = delete;
 	Shader &operator=(const Shader &) = delete;
 
-	Shader(Shader &&other) : mID(other.mID)
+	Shader(Shader &&other) : mID(other.mID), mLocations(std::move(other.mLocations)), mBlockIndices(std::move(other.mBlockIndices))
 	{
 		other.mID = 0; //Use the "null" texture for the old object.
 	}
@@ -33,28 +75,44 @@ public:
 			release();
 			//ID is now 0.
 			std::swap(mID, other.mID);
+			std::swap(mLocations, other.mLocations);
+			std::swap(mBlockIndices, other.mBlockIndices);
 		}
+
+		return *this;
 	}
 
+	static std::string readSource(const GLchar* path);
+
 	GLuint getId() const;
 	void use() const;
 
-	void setBool(const std::string &name, bool value) const;
-	void setInt(const std::string &name, int value) const;
-	void setFloat(const std::string &name, float value) const;
-	void setVec2(const std::string &name, const glm::vec2 &value) const;
-	void setVec2(const std::string &name, float x, float y) const;
-	void setVec3(const std::string &name, const glm::vec3 &value) const;
-	void setVec3(const std::string &name, float x, float y, float z) const;
-	void setVec4(const std::string &name, const glm::vec4 &value) const;
-	void setVec4(const std::string &name, float x, float y, float z, float w) const;
-	void setMat2(const std::string &name, const glm::mat2 &mat) const;
-	void setMat3(const std::string &name, const glm::mat3 &mat) const;
-	void setMat4(const std::string &name, const glm::mat4 &mat) const;
+	void setBool(UniformName name, bool value) const;
+	void setInt(UniformName name, int value) const;
+	void setFloat(UniformName name, float value) const;
+	void setVec2(UniformName name, const glm::vec2 &value) const;
+	void setVec2(UniformName name, float x, float y) const;
+	void setVec3(UniformName name, const glm::vec3 &value) const;
+	void setVec3(UniformName name, float x, float y, float z) const;
+	void setVec4(UniformName name, const glm::vec4 &value) const;
+	void setVec4(UniformName name, float x, float y, float z, float w) const;
+	void setMat2(UniformName name, const glm::mat2 &mat) const;
+	void setMat3(UniformName name, const glm::mat3 &mat) const;
+	void setMat4(UniformName name, const glm::mat4 &mat) const;
+	void setUniformBlock(UniformName name, GLuint bindingPoint) const;
+
+	// -1 for names the program doesn't use, which glUniform ignores
+	GLint getLocation(UniformName name) const;
 
 private:
+	// Name hash and location or block index, sorted by hash
+	using Entry = std::pair<uint32_t, GLint>;
+
 	GLuint mID = 0;
+	std::vector<Entry> mLocations;
+	std::vector<Entry> mBlockIndices;
 
+	void resolveUniforms();
 	void release();
 };
 
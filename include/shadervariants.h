@@ -0,0 +1,30 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "shader.h"
+
+// Permutations of one shader, built from the same sources with different defines. Variants are
+// keyed by a set of flags, their defines are only built when they are first asked for and
+// compiled, picking a compiled variant doesn't allocate.
+class ShaderVariants
+{
+public:
+	using DefinesFunction = std::function<std::vector<std::string>(unsigned int variant)>;
+
+	ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, const DefinesFunction& defines);
+
+	const Shader& get(unsigned int variant);
+
+private:
+	std::string mVertexPath;
+	std::string mFragmentPath;
+	DefinesFunction mDefines;
+	std::map<unsigned int, std::unique_ptr<Shader>> mVariants;
+};
+
+#endif //SHADERVARIANTS_H
@@ -0,0 +1,49 @@
+#ifndef SHAREDEXPONENT_H
+#define SHAREDEXPONENT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace SharedExponent {
+	const int MANTISSA_BITS = 9;
+	const int EXPONENT_BIAS = 15;
+	const int MAX_EXPONENT = 31;
+
+	// GL_RGB9_E5 texel in the GL_UNSIGNED_INT_5_9_9_9_REV layout, as specified by EXT_texture_shared_exponent
+	inline uint32_t fromRGB(float r, float g, float b)
+	{
+		const float maxValue = std::ldexp(static_cast<float>((1 << MANTISSA_BITS) - 1), MAX_EXPONENT - EXPONENT_BIAS - MANTISSA_BITS);
+
+		// Negative and NaN components clamp to zero
+		r = r > 0.0f ? std::min(r, maxValue) : 0.0f;
+		g = g > 0.0f ? std::min(g, maxValue) : 0.0f;
+		b = b > 0.0f ? std::min(b, maxValue) : 0.0f;
+
+		float maxComponent = std::max(r, std::max(g, b));
+		int exponent = -EXPONENT_BIAS - 1;
+
+		if (maxComponent > 0.0f) {
+			int frexpExponent;
+			std::frexp(maxComponent, &frexpExponent);
+			exponent = std::max(exponent, frexpExponent - 1); // floor(log2(maxComponent))
+		}
+
+		int sharedExponent = exponent + 1 + EXPONENT_BIAS;
+		float scale = std::ldexp(1.0f, sharedExponent - EXPONENT_BIAS - MANTISSA_BITS);
+
+		// Rounding can overflow the mantissa, the exponent goes up one step then
+		if (static_cast<int>(std::floor(maxComponent / scale + 0.5f)) == (1 << MANTISSA_BITS)) {
+			sharedExponent++;
+			scale *= 2.0f;
+		}
+
+		uint32_t red = static_cast<uint32_t>(std::floor(r / scale + 0.5f));
+		uint32_t green = static_cast<uint32_t>(std::floor(g / scale + 0.5f));
+		uint32_t blue = static_cast<uint32_t>(std::floor(b / scale + 0.5f));
+
+		return red | (green << 9) | (blue << 18) | (static_cast<uint32_t>(sharedExponent) << 27);
+	}
+}
+
+#endif //SHAREDEXPONENT_H
@@ -0,0 +1,24 @@
+#ifndef SHPROJECTION_H
+#define SHPROJECTION_H
+
+#include <array>
+#include <glm/glm.hpp>
+
+namespace SHProjection {
+	// L2 spherical harmonics, 9 RGB coefficients
+	typedef std::array<glm::vec3, 9> Coefficients;
+
+	// Face resolution projected by the bakes, the L2 basis can't hold more detail than that anyway
+	const int SOURCE_RESOLUTION = 64;
+
+	// Smallest environment mip that is still at least SOURCE_RESOLUTION
+	int sourceMip(int environmentResolution, int environmentMipLevels);
+
+	// Projects a cubemap onto the first 9 SH basis functions and convolves it with the clamped cosine lobe.
+	// faces holds the 6 faces in GL order as RGBA floats, faceRes x faceRes texels each.
+	// The basis constants are folded into the result so the shader evaluates irradiance / PI as
+	// c0 + c1 y + c2 z + c3 x + c4 xy + c5 yz + c6 (3z^2 - 1) + c7 xz + c8 (x^2 - y^2)
+	Coefficients projectCubeMap(const float* faces, int faceRes);
+}
+
+#endif //SHPROJECTION_H
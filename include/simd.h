@@ -0,0 +1,23 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Instruction sets available to the CPU kernels. SSE2 is part of the x86-64 baseline,
+// the scalar paths are used everywhere else.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PBR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Wider kernels, only when the build targets AVX2 (PBR_ENABLE_AVX2 in CMake)
+#if defined(__AVX2__)
+#define PBR_AVX2 1
+#include <immintrin.h>
+#endif
+
+// MSVC has no F16C switch, every AVX2 CPU supports it
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define PBR_F16C 1
+#include <immintrin.h>
+#endif
+
+#endif //SIMD_H
@@ -0,0 +1,53 @@
+#ifndef SPHERICALHARMONICS_H
+#define SPHERICALHARMONICS_H
+
+#include <glad/glad.h>
+#include <string>
+#include "shprojection.h"
+
+// Irradiance as L2 spherical harmonics, stored in a std140 uniform buffer
+// matching the IrradianceSH block of irradiancesh.glsl.
+class SphericalHarmonics
+{
+public:
+	static const GLuint BINDING_POINT = 0;
+
+	SphericalHarmonics();
+	~SphericalHarmonics();
+
+	//Delete the copy constructor/assignment.
+	SphericalHarmonics(const SphericalHarmonics &) = delete;
+	SphericalHarmonics &operator=(const SphericalHarmonics &) = delete;
+
+	SphericalHarmonics(SphericalHarmonics &&other) : mID(other.mID), mCoefficients(other.mCoefficients)
+	{
+		other.mID = 0; //Use the "null" buffer for the old object.
+	}
+
+	SphericalHarmonics &operator=(SphericalHarmonics &&other)
+	{
+		//ALWAYS check for self-assignment.
+		if (this != &other)
+		{
+			release();
+			//ID is now 0.
+			std::swap(mID, other.mID);
+			mCoefficients = other.mCoefficients;
+		}
+
+		return *this;
+	}
+
+	GLuint getId() const;
+	void bind(GLuint bindingPoint) const;
+	void setCoefficients(const SHProjection::Coefficients& coefficients);
+	const SHProjection::Coefficients& getCoefficients() const;
+
+private:
+	GLuint mID = 0;
+	SHProjection::Coefficients mCoefficients = {};
+
+	void release();
+};
+
+#endif //SPHERICALHARMONICS_H
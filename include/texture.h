@@ -2,13 +2,14 @@
 #define TEXTURE_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
 
 class Texture
 {
 public:
 	Texture();
-	Texture(const GLchar* texturePath, bool srgb = false);
 	~Texture();
 
 	//Delete the copy constructor/assignment.
@@ -29,15 +30,37 @@ public:
 			//ID is now 0.
 			std::swap(mID, other.mID);
 		}
+
+		return *this;
 	}
 
 	GLuint getId() const;
 	void bind(GLenum textureUnit) const;
 
+	// Every texel holds the value, as sampled by the shaders. Set by TextureLoader, materials
+	// then read the value from a uniform instead of sampling the texture.
+	void setConstant(bool constant, const glm::vec4& value);
+	bool isConstant() const;
+	const glm::vec4& getConstantValue() const;
+
+	// Smallest and largest value of each channel as sampled by the shaders, [0, 1] when unknown
+	void setValueRange(const glm::vec4& minValue, const glm::vec4& maxValue);
+	const glm::vec4& getMinValue() const;
+	const glm::vec4& getMaxValue() const;
+
+	// Hash of the files the texels were read from, 0 until known. Set by TextureLoader once the
+	// files are decoded or reloaded, TextureRegistry keys the texture by it.
+	void setContentHash(uint64_t hash);
+	uint64_t getContentHash() const;
+
 private:
 	GLuint mID = 0;
+	bool mConstant = false;
+	glm::vec4 mConstantValue = glm::vec4(0.0f);
+	glm::vec4 mMinValue = glm::vec4(0.0f);
+	glm::vec4 mMaxValue = glm::vec4(1.0f);
+	uint64_t mContentHash = 0;
 
-	void loadTexture(const GLchar* texturePath, bool srgb);
 	void release();
 };
 
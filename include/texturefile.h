@@ -0,0 +1,23 @@
+#ifndef TEXTUREFILE_H
+#define TEXTUREFILE_H
+
+#include <cstddef>
+#include <string>
+#include "mappedfile.h"
+#include "texturelevels.h"
+
+// GPU-ready 2D textures, written by pbr_texpack. A file is a single BakeCache blob holding every
+// level in its final format (uncompressed, block compressed or half float). Cube maps aren't
+// supported, the loader only creates 2D textures. Files are memory mapped and their levels
+// uploaded straight from the mapping, nothing is decoded or copied.
+namespace TextureFile {
+	const char* const EXTENSION = ".pbrtex";
+
+	bool isTextureFile(const std::string& path);
+
+	// The levels read from the file, which must stay open while they are used
+	bool map(const MappedFile& file, TextureLevels& levels);
+	bool write(const std::string& path, const TextureLevels& levels);
+}
+
+#endif //TEXTUREFILE_H
@@ -0,0 +1,45 @@
+#ifndef TEXTURELEVELS_H
+#define TEXTURELEVELS_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Texture contents on the CPU, faces of a level are stored one after the other. Block compressed
+// formats have no client format and type, bytesPerPixel is the size of a 4x4 block then.
+// Only GL enums are used here, no context is needed.
+struct TextureLevels
+{
+	GLint internalFormat = 0;
+	GLenum format = 0;
+	GLenum type = 0;
+	int width = 0;
+	int height = 0;
+	int faces = 0;
+	int mipLevels = 0;
+	uint32_t bytesPerPixel = 0;
+	std::vector<char> data;
+	// Set by map(), the levels are then read in place from memory owned by the caller and data stays empty
+	const char* mapped = nullptr;
+
+	// Sets the client layout used to read back and re-upload the internal format,
+	// false if it isn't supported
+	bool setInternalFormat(GLint internalFormat);
+
+	bool isCompressed() const;
+	bool isEmpty() const;
+	size_t levelSize(int mip) const;
+	size_t totalSize() const;
+	const char* faceData(int mip, int face) const;
+	char* faceData(int mip, int face);
+
+	// Binary blob of a header followed by the levels, as stored by the BakeCache
+	void serialize(std::vector<char>& blob) const;
+	// Reads the blob at the start of data, blobSize is set to the number of bytes it spans
+	bool deserialize(const char* blob, size_t size, size_t& blobSize);
+	// Like deserialize without copying the levels, the blob must outlive them. Mapped levels are read-only.
+	bool map(const char* blob, size_t size, size_t& blobSize);
+};
+
+#endif //TEXTURELEVELS_H
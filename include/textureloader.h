@@ -0,0 +1,169 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bakecache.h"
+#include "mappedfile.h"
+#include "mipgenerator.h"
+#include "texture.h"
+#include "texturelevels.h"
+
+// Loads material textures without blocking the render loop. Images are decoded and their mip
+// chain generated by a pool of worker threads, then the levels are streamed to the GPU in bands
+// of rows through a pixel buffer object by update(), coarsest first. The returned texture shows
+// a 1x1 placeholder until its coarsest level is uploaded, GL_TEXTURE_BASE_LEVEL then follows the
+// finer levels as they come in.
+// Only the levels the material needs at its current size on screen (see setPixelsPerUv) are
+// resident. The decoded levels are kept, textures are reallocated with immutable storage when
+// finer levels are needed or when coarser ones are enough.
+// Each usage has its own format: sRGB RGBA8 for colors, RG8 for normals, R8 for scalar maps, R16
+// for heights and RGBA8 for packed maps. All but heights are then block compressed: BC7 (or BC1
+// without BPTC support) for colors, BC5 for normals, BC4 for scalar maps and BC7 for packed maps.
+// Compressed levels are kept in the bake cache, keyed by file content, so an image is only encoded once.
+// Cache entries and GPU-ready texture files (see TextureFile) are memory mapped and uploaded in place.
+// Reloaded textures keep their uncompressed levels, later edits only filter, encode and upload
+// the texels that changed.
+// The content hash of the files is computed by the workers while they read them, and set on
+// the texture (see Texture::getContentHash) along with the levels.
+// Maps whose texels all hold nearly the same value are kept as a single texel and flagged on
+// the texture (see Texture::isConstant), materials then use the value instead of sampling them.
+// The smallest and largest value of each channel are set on the texture as well, kept in the
+// bake cache along with the levels. GPU-ready texture files are used as they are.
+// Workers never touch stbi_set_flip_vertically_on_load, images are kept top row first.
+class TextureLoader
+{
+public:
+	// Contents of a material map, decides its GPU format
+	enum Usage { COLOR, NORMAL, SCALAR, HEIGHT, PACKED };
+
+	TextureLoader();
+	~TextureLoader();
+
+	//Delete the copy constructor/assignment.
+	TextureLoader(const TextureLoader &) = delete;
+	TextureLoader &operator=(const TextureLoader &) = delete;
+
+	// Colors are sRGB, normals only keep their X and Y, scalar maps and heights their red channel
+	std::shared_ptr<Texture> load(const std::string& texturePath, Usage usage = SCALAR, const glm::u8vec4& placeholder = glm::u8vec4(128, 128, 128, 255));
+
+	// Packs three grayscale maps into the red, green and blue channels of one PACKED texture.
+	// Maps smaller than the largest one are resampled to its size.
+	std::shared_ptr<Texture> loadPacked(const std::string& redPath, const std::string& greenPath, const std::string& bluePath, const glm::u8vec4& placeholder);
+
+	// Reads the files of a loaded texture again after they changed on disk. The texture keeps
+	// showing its current texels until the changed ones are uploaded. False if the texture isn't
+	// uploaded yet.
+	bool reload(const std::shared_ptr<Texture>& texture);
+
+	// Uploads up to byteBudget bytes of decoded pixels, at least one band
+	void update(size_t byteBudget);
+	bool isLoading() const;
+
+	// Screen pixels covered by the [0, 1] texture coordinate range of the material, decides the
+	// finest level each texture needs. Every level is resident until it is set.
+	void setPixelsPerUv(const glm::vec2& pixelsPerUv);
+
+	// GPU memory used by the streamed textures
+	size_t getResidentBytes() const;
+
+	// Mip filter of the textures loaded from now on
+	void setMipFilter(MipGenerator::Filter filter);
+
+private:
+	struct Job
+	{
+		std::weak_ptr<Texture> texture;
+		std::vector<std::string> paths; // Three for PACKED textures
+		Usage usage = SCALAR;
+		GLenum internalFormat = GL_R8; // Of the decoded levels
+		GLenum compression = 0; // Uncompressed if 0
+		MipGenerator::Filter filter = MipGenerator::KAISER;
+		TextureLevels levels; // Empty if the image couldn't be decoded
+		MappedFile mapped; // Backs the levels when they are read in place
+		uint64_t contentHash = 0; // Of the files, 0 if they couldn't be read
+		bool constant = false; // The levels are a single texel of the value
+		glm::vec4 constantValue = glm::vec4(0.0f);
+		glm::vec4 minValue = glm::vec4(0.0f); // Per channel, [0, 1] when unknown
+		glm::vec4 maxValue = glm::vec4(1.0f);
+
+		// Uncompressed levels, kept from the first reload on. Only touched by the reload in flight.
+		TextureLevels sourceLevels;
+
+		// Render thread only. The texture has storage for the levels [allocatedMip, mipLevels) and
+		// shows [residentMip, mipLevels), the placeholder until shown.
+		int allocatedMip = 0;
+		int residentMip = 0;
+		int wantedMip = 0;
+		bool shown = false;
+		bool restage = false; // The storage doesn't match the reloaded levels anymore
+		bool reloading = false;
+		bool reloadAgain = false; // The files changed again while reloading
+
+		// Replaces the texture once it shows as many levels, filled band by band, coarsest level first
+		std::unique_ptr<Texture> staging = nullptr;
+		int stagingAllocatedMip = 0;
+		int stagingResidentMip = 0;
+
+		int uploadedRows = 0; // Of the level being uploaded, in the staging texture if there is one
+	};
+
+	// New content of a reloaded texture
+	struct Reload
+	{
+		std::shared_ptr<Job> job;
+		TextureLevels levels; // Empty if nothing changed
+		std::vector<MipGenerator::Region> regions; // Changed in each level, all of them if resized
+		bool resized = false;
+		bool failed = false;
+		uint64_t contentHash = 0;
+		bool constant = false;
+		glm::vec4 constantValue = glm::vec4(0.0f);
+		glm::vec4 minValue = glm::vec4(0.0f);
+		glm::vec4 maxValue = glm::vec4(1.0f);
+	};
+
+	std::vector<std::thread> mWorkers;
+	std::deque<std::function<void()>> mTasks;
+	std::deque<std::shared_ptr<Job>> mDecoded;
+	std::deque<std::shared_ptr<Reload>> mReloaded;
+	mutable std::mutex mMutex;
+	std::condition_variable mCondition;
+	BakeCache mBakeCache;
+	bool mStopping = false;
+	size_t mPending = 0;
+
+	// Render thread only
+	std::vector<std::shared_ptr<Job>> mStreamed;
+	GLuint mPixelBuffer = 0;
+	MipGenerator::Filter mMipFilter = MipGenerator::KAISER;
+	glm::vec2 mPixelsPerUv = glm::vec2(std::numeric_limits<float>::max());
+
+	static uint64_t contentHash(const std::vector<MappedFile>& imageFiles);
+	static std::string cacheKey(uint64_t contentHash, GLenum compression, MipGenerator::Filter filter);
+	std::shared_ptr<Texture> enqueue(const std::vector<std::string>& texturePaths, Usage usage, const glm::u8vec4& placeholder);
+	static bool decodePixels(const std::vector<MappedFile>& files, Usage usage, GLenum internalFormat, std::vector<uint8_t>& pixels, int& width, int& height);
+	void decode(Job& job) const;
+	void decodeChanges(Reload& reload) const;
+	void queueReload(const std::shared_ptr<Job>& job);
+	void applyReload(Job& job, Reload& reload);
+	void workerLoop();
+	int wantedMip(const TextureLevels& levels) const;
+	void updateResidency(Job& job) const;
+	static int pendingMip(const Job& job);
+	size_t uploadBand(Job& job);
+	void uploadRegion(const TextureLevels& levels, int mip, int level, const MipGenerator::Region& region);
+};
+
+#endif //TEXTURELOADER_H
@@ -0,0 +1,81 @@
+#ifndef TEXTUREREGISTRY_H
+#define TEXTUREREGISTRY_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "texture.h"
+#include "textureloader.h"
+
+// Shares material textures between slots and reloads. Requests are keyed by the paths, modification
+// times, sizes and usage of the files, they only stat them. Once the loader hashed the files
+// (see Texture::getContentHash) the texture is keyed by content hash and usage instead, a file
+// found under two paths then ends up with a single texture. Textures no slot uses anymore are kept
+// in a small LRU before being freed. Files changed on disk are reloaded in place, their textures
+// keep their key until the reload is done and are then keyed by their new content.
+class TextureRegistry
+{
+public:
+	TextureRegistry(TextureLoader& loader, size_t unusedCapacity = 8);
+
+	std::shared_ptr<Texture> acquire(const std::string& texturePath, TextureLoader::Usage usage = TextureLoader::SCALAR, const glm::u8vec4& placeholder = glm::u8vec4(128, 128, 128, 255));
+
+	// Keyed by the content of the three maps, see TextureLoader::loadPacked
+	std::shared_ptr<Texture> acquirePacked(const std::string& redPath, const std::string& greenPath, const std::string& bluePath, const glm::u8vec4& placeholder);
+
+	// Keys the textures whose content hash came in or changed, evicts the least recently used
+	// textures past the unused capacity
+	void update();
+
+	// Reloads the textures read from a file that changed on disk
+	void reload(const std::string& texturePath);
+
+	// Files the textures are read from, embedded resources included
+	std::vector<std::string> getPaths() const;
+	// Advanced whenever textures are added or removed, getPaths() can only change with it
+	uint64_t getRevision() const;
+
+	unsigned int getHits() const;
+	unsigned int getMisses() const;
+	size_t getResidentCount() const;
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Texture> texture;
+		std::vector<std::string> paths;
+		TextureLoader::Usage usage = TextureLoader::SCALAR;
+		uint64_t lastUse = 0;
+		uint64_t contentHash = 0; // The entry is keyed by, 0 while keyed by file version
+	};
+
+	typedef std::unordered_map<std::string, Entry> Entries;
+
+	TextureLoader& mLoader;
+	size_t mUnusedCapacity;
+	Entries mEntries;
+	// Key of the entry each file version leads to
+	std::unordered_map<std::string, std::string> mVersions;
+	uint64_t mClock = 0; // Advanced by update()
+	uint64_t mRevision = 0;
+	// Last use and entry of the unused textures, and the entries whose content hash changed. Kept
+	// between updates so they don't allocate.
+	std::vector<std::pair<uint64_t, Entries::iterator>> mUnused;
+	std::vector<Entries::iterator> mChanged;
+	std::vector<Entries::node_type> mRekeyed;
+	unsigned int mHits = 0;
+	unsigned int mMisses = 0;
+
+	static bool versionKey(const std::vector<std::string>& texturePaths, TextureLoader::Usage usage, std::string& key);
+	static std::string contentKey(uint64_t contentHash, TextureLoader::Usage usage);
+	std::shared_ptr<Texture> find(const std::string& version);
+	std::shared_ptr<Texture> insert(const std::string& version, const Entry& entry);
+	void rekey();
+	void forgetVersions(const std::string& key);
+};
+
+#endif //TEXTUREREGISTRY_H
@@ -0,0 +1,56 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+// Uniform blocks shared by every program, declared once in shaders/uniforms.glsl. The structs
+// mirror their std140 layout, programs bind the blocks to these points when they are linked.
+namespace UniformBlocks {
+	// SphericalHarmonics::BINDING_POINT is 0
+	const GLuint FRAME_BINDING_POINT = 1;
+	const GLuint OBJECT_BINDING_POINT = 2;
+	const GLuint MATERIAL_BINDING_POINT = 3;
+
+	// Camera and lighting, written once per frame
+	struct FrameData
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 eyePos;
+		int32_t lightEnabled; // bool
+		glm::vec3 lightPos;
+		float padding;
+	};
+
+	// Transform of the mesh being drawn (see Mesh::setTransform)
+	struct ObjectData
+	{
+		glm::mat4 model;
+		glm::vec4 normalMat[3]; // mat3 columns are padded to a vec4
+		float displacementAmount;
+		float padding[3];
+	};
+
+	// Values of the constant maps and texture scale (see Material::use)
+	struct MaterialData
+	{
+		glm::vec4 albedoValue;
+		glm::vec4 normalValue;
+		glm::vec4 ormValue;
+		glm::vec4 metallicValue;
+		glm::vec4 roughnessValue;
+		glm::vec4 aoValue;
+		glm::vec4 displacementValue;
+		glm::vec2 textureScale;
+		float padding[2];
+	};
+
+	static_assert(offsetof(FrameData, lightPos) == 144 && sizeof(FrameData) == 160, "FrameData doesn't match std140");
+	static_assert(offsetof(ObjectData, displacementAmount) == 112 && sizeof(ObjectData) == 128, "ObjectData doesn't match std140");
+	static_assert(offsetof(MaterialData, textureScale) == 112 && sizeof(MaterialData) == 128, "MaterialData doesn't match std140");
+}
+
+#endif //UNIFORMBLOCKS_H
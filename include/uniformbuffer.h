@@ -0,0 +1,54 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Uniform buffer holding one std140 block (see uniformblocks.h). The buffer is created on the
+// first update, contents are written with a single mapped write and only when they changed.
+class UniformBuffer
+{
+public:
+	explicit UniformBuffer(size_t size);
+	~UniformBuffer();
+
+	//Delete the copy constructor/assignment.
+	UniformBuffer(const UniformBuffer &) = delete;
+	UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+	UniformBuffer(UniformBuffer &&other) : mID(other.mID), mContents(std::move(other.mContents))
+	{
+		other.mID = 0; //Use the "null" buffer for the old object.
+	}
+
+	UniformBuffer &operator=(UniformBuffer &&other)
+	{
+		//ALWAYS check for self-assignment.
+		if (this != &other)
+		{
+			release();
+			//ID is now 0.
+			std::swap(mID, other.mID);
+			std::swap(mContents, other.mContents);
+		}
+
+		return *this;
+	}
+
+	GLuint getId() const;
+	// Binds nothing until the first update
+	void bind(GLuint bindingPoint) const;
+	// Copies size bytes from data, returns whether the buffer was written
+	bool update(const void* data);
+
+private:
+	GLuint mID = 0;
+	std::vector<uint8_t> mContents;
+
+	void release();
+};
+
+#endif //UNIFORMBUFFER_H
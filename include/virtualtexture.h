@@ -0,0 +1,94 @@
+#ifndef VIRTUALTEXTURE_H
+#define VIRTUALTEXTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "mappedfile.h"
+#include "shader.h"
+#include "virtualtexturefile.h"
+
+// Texture too large to be resident, streamed tile by tile from a VirtualTextureFile. Resident tiles
+// live in a physical cache texture, the page table (one texel per tile, one level per level) tells
+// the shader where: RGB hold the cache page and the level it contains. Tiles that aren't resident
+// point at their closest resident ancestor, the coarsest level is always resident.
+// The tiles the shader touched are reported by a VirtualTextureFeedback pass, a worker thread
+// reads them from the mapped file and update() uploads them.
+class VirtualTexture
+{
+public:
+	VirtualTexture();
+	~VirtualTexture();
+
+	//Delete the copy constructor/assignment.
+	VirtualTexture(const VirtualTexture &) = delete;
+	VirtualTexture &operator=(const VirtualTexture &) = delete;
+
+	bool open(const std::string& path);
+
+	// Requests the tiles of a feedback readback, each texel holds a tile x, y, level and 1 if written
+	void requestTiles(const std::vector<uint16_t>& feedback);
+	// Uploads up to maxTiles loaded tiles and refreshes the page table
+	void update(int maxTiles);
+
+	// Sets <name>PageTable, <name>Cache and <name>Virtual
+	void bind(const Shader& shader, UniformName name, unsigned int& textureUnit) const;
+	// Virtual size (xy), level count (z) and cache pages per side (w), as the shaders expect it
+	glm::vec4 getParameters() const;
+	GLuint getCacheId() const;
+	size_t getResidentCount() const;
+
+	// Tile layout constants of the shaders sampling virtual textures
+	static std::vector<std::string> shaderDefines();
+
+private:
+	struct Tile
+	{
+		uint64_t id;
+		std::vector<char> data;
+	};
+
+	struct Page
+	{
+		uint64_t id = 0;
+		uint64_t lastUsed = 0;
+		bool used = false;
+		bool pinned = false;
+	};
+
+	MappedFile mFile;
+	VirtualTextureFile::Info mInfo;
+	GLuint mCache = 0;
+	GLuint mPageTable = 0;
+	std::vector<Page> mPages;
+	std::unordered_map<uint64_t, size_t> mResident; // Tile to page
+	std::unordered_set<uint64_t> mRequested; // Queued or loading
+	std::vector<std::vector<uint8_t>> mPageTableLevels;
+	uint64_t mFrame = 0;
+	bool mPageTableDirty = false;
+
+	std::thread mWorker;
+	std::deque<uint64_t> mQueue;
+	std::deque<Tile> mLoaded;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStopping = false;
+
+	static uint64_t tileId(int mip, int x, int y);
+	void loadTile(uint64_t id, std::vector<char>& data) const;
+	void uploadTile(const Tile& tile, bool pinned);
+	void refreshPageTable();
+	void workerLoop();
+	void close();
+};
+
+#endif //VIRTUALTEXTURE_H
@@ -0,0 +1,53 @@
+#ifndef VIRTUALTEXTUREFEEDBACK_H
+#define VIRTUALTEXTUREFEEDBACK_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Low resolution pass writing, for every pixel, the virtual texture tile and level the shaders
+// sample (shaderfeedback.fs). It is read back asynchronously, the tiles seen in a frame are
+// requested one or two frames later. One virtual texture is tracked per pass.
+class VirtualTextureFeedback
+{
+public:
+	VirtualTextureFeedback();
+	~VirtualTextureFeedback();
+
+	//Delete the copy constructor/assignment.
+	VirtualTextureFeedback(const VirtualTextureFeedback &) = delete;
+	VirtualTextureFeedback &operator=(const VirtualTextureFeedback &) = delete;
+
+	// Binds and clears the feedback framebuffer, sized from the screen
+	void begin(int screenWidth, int screenHeight);
+	// Starts the readback of what was drawn since begin()
+	void end();
+	// Texels of the oldest finished readback, four per pixel. False if none finished.
+	bool read(std::vector<uint16_t>& texels);
+
+	// Added to the level computed by the feedback shader, the pass runs at a fraction of the resolution
+	float getLodBias() const;
+
+private:
+	static const int READBACKS = 2;
+
+	struct Readback
+	{
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+		size_t size = 0;
+	};
+
+	GLuint mFramebuffer = 0;
+	GLuint mColorBuffer = 0;
+	GLuint mDepthBuffer = 0;
+	int mWidth = 0;
+	int mHeight = 0;
+	Readback mReadbacks[READBACKS];
+	int mNextReadback = 0;
+
+	void resize(int width, int height);
+};
+
+#endif //VIRTUALTEXTUREFEEDBACK_H
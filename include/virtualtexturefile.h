@@ -0,0 +1,46 @@
+#ifndef VIRTUALTEXTUREFILE_H
+#define VIRTUALTEXTUREFILE_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "texturelevels.h"
+
+// Tiles of a virtual texture, written by pbr_texpack. Every level down to the first one a single
+// tile high or wide is cut in square tiles, each stored with a border of the neighbouring texels
+// (wrapping around like the material textures) so it can be filtered on its own once it sits in
+// the physical cache. Layout: a header, then the tiles of each level, finest level first, row by
+// row, all the same size. Sizes are powers of two of at least one tile.
+namespace VirtualTextureFile {
+	const char* const EXTENSION = ".pbrvt";
+	const int TILE_SIZE = 128; // Texels of content per side
+	const int TILE_BORDER = 4; // Keeps compressed blocks aligned
+	const int PAGE_SIZE = TILE_SIZE + 2 * TILE_BORDER; // Texels per side of a stored tile
+
+	struct Info
+	{
+		GLint internalFormat = 0;
+		int width = 0;
+		int height = 0;
+		int mipLevels = 0;
+		size_t tileBytes = 0;
+
+		int tilesX(int mip) const;
+		int tilesY(int mip) const;
+		// From the start of the file
+		size_t tileOffset(int mip, int x, int y) const;
+		size_t fileSize() const;
+	};
+
+	bool isTileFile(const std::string& path);
+
+	// Levels the virtual texture of an image keeps, 0 if its size can't be tiled
+	int mipLevelCount(int width, int height);
+
+	bool read(const char* data, size_t size, Info& info);
+	// Cuts the tiles out of uncompressed levels and block compresses them to compression unless it is 0
+	bool write(const std::string& path, const TextureLevels& levels, GLenum compression);
+}
+
+#endif //VIRTUALTEXTUREFILE_H
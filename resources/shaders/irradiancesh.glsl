@@ -0,0 +1,20 @@
+// Evaluation of the IrradianceSH block written by SphericalHarmonics, shared by the PBR and skybox shaders
+
+// Irradiance / PI as L2 spherical harmonics, basis constants are pre-multiplied on the CPU
+layout(std140) uniform IrradianceSH
+{
+	vec4 shCoefficients[9];
+};
+
+vec3 irradianceSH(vec3 n)
+{
+	return shCoefficients[0].rgb
+		+ shCoefficients[1].rgb * n.y
+		+ shCoefficients[2].rgb * n.z
+		+ shCoefficients[3].rgb * n.x
+		+ shCoefficients[4].rgb * (n.x * n.y)
+		+ shCoefficients[5].rgb * (n.y * n.z)
+		+ shCoefficients[6].rgb * (3.0 * n.z * n.z - 1.0)
+		+ shCoefficients[7].rgb * (n.x * n.z)
+		+ shCoefficients[8].rgb * (n.x * n.x - n.y * n.y);
+}
@@ -0,0 +1,23 @@
+#version 330 core
+
+// Virtual texture tile and level sampled by each pixel, read back by VirtualTextureFeedback
+in vec2 TexCoords;
+
+layout(location = 0) out uvec4 FragTile;
+
+// Virtual size (xy), level count (z)
+uniform vec4 virtualParameters;
+uniform float lodBias;
+
+void main()
+{
+	vec2 texel = TexCoords * virtualParameters.xy;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias, 0.0, virtualParameters.z - 1.0);
+	float level = floor(lod);
+
+	vec2 tiles = virtualParameters.xy / (VIRTUAL_TILE_SIZE * exp2(level));
+	uvec2 tile = uvec2(min(fract(TexCoords) * tiles, tiles - 1.0));
+	FragTile = uvec4(tile, uint(level), 1u);
+}
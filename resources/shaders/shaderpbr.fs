@@ -11,17 +11,43 @@ in mat3 iTBN;
 
 out vec4 FragColor;
 
+#ifdef VIRTUAL_ALBEDO
+// Virtual texture (see VirtualTexture): page table entries hold the cache page (xy) and its level (z)
+uniform sampler2D albedoPageTable;
+uniform sampler2D albedoCache;
+// Virtual size (xy), level count (z) and cache pages per side (w)
+uniform vec4 albedoVirtual;
+#elif !defined(CONSTANT_ALBEDO)
 uniform sampler2D albedoMap;
+#endif
+// Constant maps (see Material::shaderDefines) are read from the MaterialData block instead
+#ifndef CONSTANT_NORMAL
 uniform sampler2D normalMap;
+#endif
+#ifdef PACKED_ORM
+// Occlusion, roughness and metallic in the red, green and blue channels
+#ifndef CONSTANT_ORM
+uniform sampler2D ormMap;
+#endif
+#else
+#ifndef CONSTANT_METALLIC
 uniform sampler2D metallicMap;
+#endif
+#ifndef CONSTANT_ROUGHNESS
 uniform sampler2D roughnessMap;
+#endif
+#ifndef CONSTANT_AO
 uniform sampler2D aoMap;
+#endif
+#endif
 uniform sampler2D brdfLUT;
-uniform samplerCube irradianceMap;
 uniform samplerCube environmentMap;
 uniform samplerCube preFilterMap;
 uniform float heightScale;
-uniform bool lightEnabled;
+
+#include "uniforms.glsl"
+
+#include "irradiancesh.glsl"
 
 // Trowbridge-Reitz GGX normal distribution function
 float DistributionGGX(vec3 N, vec3 H, float roughness);
@@ -34,19 +60,84 @@ float GeometrySchlickGGX(float NdotV, float roughness);
 vec3 fresnelSchlick(float cosTheta, vec3 F0);
 vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness);
 
+#ifdef VIRTUAL_ALBEDO
+vec4 sampleVirtualLevel(sampler2D pageTable, sampler2D cache, vec4 parameters, vec2 uv, float level)
+{
+	vec2 tiles = parameters.xy / (VIRTUAL_TILE_SIZE * exp2(level));
+	ivec2 tile = ivec2(min(uv * tiles, tiles - 1.0));
+	vec3 entry = floor(texelFetch(pageTable, tile, int(level)).xyz * 255.0 + 0.5);
+
+	// Position inside the resident tile, an ancestor while the requested one loads
+	vec2 residentTiles = parameters.xy / (VIRTUAL_TILE_SIZE * exp2(entry.z));
+	vec2 texel = entry.xy * VIRTUAL_PAGE_SIZE + VIRTUAL_TILE_BORDER + fract(uv * residentTiles) * VIRTUAL_TILE_SIZE;
+	return textureLod(cache, texel / (parameters.w * VIRTUAL_PAGE_SIZE), 0.0);
+}
+
+// Trilinear filtering between the two closest levels, the cache has no mipmaps of its own
+vec4 sampleVirtual(sampler2D pageTable, sampler2D cache, vec4 parameters, vec2 texCoords)
+{
+	vec2 texel = texCoords * parameters.xy;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0, parameters.z - 1.0);
+	float level = floor(lod);
+
+	vec2 uv = fract(texCoords);
+	vec4 fine = sampleVirtualLevel(pageTable, cache, parameters, uv, level);
+	vec4 coarse = sampleVirtualLevel(pageTable, cache, parameters, uv, min(level + 1.0, parameters.z - 1.0));
+	return mix(fine, coarse, lod - level);
+}
+#endif
+
 void main()
 {
 	vec2 texCoords = TexCoords;
 
+#ifdef VIRTUAL_ALBEDO
+    vec3 albedo = sampleVirtual(albedoPageTable, albedoCache, albedoVirtual, texCoords).rgb;
+#elif defined(CONSTANT_ALBEDO)
+    vec3 albedo = albedoValue.rgb;
+#else
     vec3 albedo = texture(albedoMap, texCoords).rgb;
+#endif
+#ifdef PACKED_ORM
+#ifdef CONSTANT_ORM
+    vec3 orm = ormValue.rgb;
+#else
+    vec3 orm = texture(ormMap, texCoords).rgb;
+#endif
+    float ao = orm.r;
+    float roughness = orm.g;
+    float metallic = orm.b;
+#else
+#ifdef CONSTANT_METALLIC
+    float metallic = metallicValue.r;
+#else
     float metallic = texture(metallicMap, texCoords).r;
+#endif
+#ifdef CONSTANT_ROUGHNESS
+    float roughness = roughnessValue.r;
+#else
     float roughness = texture(roughnessMap, texCoords).r;
+#endif
+#ifdef CONSTANT_AO
+    float ao = aoValue.r;
+#else
     float ao = texture(aoMap, texCoords).r;
+#endif
+#endif
 
 	vec3 lightColor = vec3(2.0, 2.0, 2.0);
 
-	vec3 N = texture(normalMap, texCoords).rgb;
-	N = normalize(N * 2.0 - 1.0);
+	// Normal maps are stored as two channels (BC5), Z is rebuilt from the unit length
+	vec3 N;
+#ifdef CONSTANT_NORMAL
+	N.xy = normalValue.rg * 2.0 - 1.0;
+#else
+	N.xy = texture(normalMap, texCoords).rg * 2.0 - 1.0;
+#endif
+	N.z = sqrt(max(1.0 - dot(N.xy, N.xy), 0.0));
+	N = normalize(N);
     vec3 V = normalize(TangentViewDir);
 	vec3 R = reflect(-V, N);
 
@@ -90,7 +181,7 @@ void main()
 	kD *= 1.0 - metallic;
 	vec3 worldSpaceNormal = iTBN * N;
 	vec3 worldSpaceReflect = iTBN * R;
-	vec3 irradiance = texture(irradianceMap, worldSpaceNormal).rgb;
+	vec3 irradiance = max(irradianceSH(normalize(worldSpaceNormal)), 0.0);
 	vec3 diffuse = irradiance * albedo;
 
 	const float MAX_REFLECTION_LOD = 4.0;
@@ -12,15 +12,11 @@ out vec3 TangentFragPos;
 out vec3 TangentLightPos;
 out mat3 iTBN;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat3 normalMat;
-uniform vec3 eyePos;
-uniform vec3 lightPos;
-uniform vec2 textureScale;
+#include "uniforms.glsl"
+
+#ifndef CONSTANT_DISPLACEMENT
 uniform sampler2D displacementMap;
-uniform float displacementAmount;
+#endif
 
 void main()
 {
@@ -28,7 +24,11 @@ void main()
 	vec3 Position = aPos;
 
 	if (displacementAmount > 0.0) {
+#ifdef CONSTANT_DISPLACEMENT
+		float k = displacementValue.r * displacementAmount;
+#else
 		float k = texture(displacementMap, TexCoords).r * displacementAmount;
+#endif
 		Position = Position + aNormal * k;
 	}
 
@@ -4,8 +4,16 @@ out vec4 FragColor;
 in vec3 TexCoords;
 
 uniform samplerCube skybox;
+uniform bool showIrradiance;
+
+#include "irradiancesh.glsl"
 
 void main()
 {    
-    FragColor = texture(skybox, TexCoords);
+    if (showIrradiance) {
+        FragColor = vec4(max(irradianceSH(normalize(TexCoords)), 0.0), 1.0);
+    }
+    else {
+        FragColor = texture(skybox, TexCoords);
+    }
 }
\ No newline at end of file
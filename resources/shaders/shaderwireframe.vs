@@ -3,12 +3,11 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 3) in vec2 aTexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec2 textureScale;
+#include "uniforms.glsl"
+
+#ifndef CONSTANT_DISPLACEMENT
 uniform sampler2D displacementMap;
-uniform float displacementAmount;
+#endif
 
 void main()
 {
@@ -16,7 +15,11 @@ void main()
 	vec2 TexCoords = aTexCoords * textureScale;
 
 	if (displacementAmount > 0.0) {
+#ifdef CONSTANT_DISPLACEMENT
+		float k = displacementValue.r * displacementAmount;
+#else
 		float k = texture(displacementMap, TexCoords).r * displacementAmount;
+#endif
 		Position = Position + aNormal * k;
 	}
 
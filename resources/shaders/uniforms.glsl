@@ -0,0 +1,32 @@
+// Uniform blocks shared by every program, in the std140 layout of the structs of uniformblocks.h
+
+// Camera and lighting, written once per frame
+layout(std140) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	vec3 eyePos;
+	bool lightEnabled;
+	vec3 lightPos;
+};
+
+// Transform of the mesh being drawn
+layout(std140) uniform ObjectData
+{
+	mat4 model;
+	mat3 normalMat;
+	float displacementAmount;
+};
+
+// Constant maps (see Material::shaderDefines) are read from their value instead of sampled
+layout(std140) uniform MaterialData
+{
+	vec4 albedoValue;
+	vec4 normalValue;
+	vec4 ormValue;
+	vec4 metallicValue;
+	vec4 roughnessValue;
+	vec4 aoValue;
+	vec4 displacementValue;
+	vec2 textureScale;
+};
@@ -0,0 +1,60 @@
+#include "assets.h"
+#include <filesystem>
+#include <unordered_map>
+#include <cmrc\cmrc.hpp>
+CMRC_DECLARE(resources);
+
+namespace fs = std::filesystem;
+
+namespace {
+	typedef std::unordered_map<std::string, cmrc::file> EmbeddedIndex;
+
+	void indexDirectory(const cmrc::embedded_filesystem& resources, const std::string& directory, EmbeddedIndex& index)
+	{
+		for (const cmrc::directory_entry& entry : resources.iterate_directory(directory)) {
+			std::string path = directory.empty() ? entry.filename() : directory + "/" + entry.filename();
+
+			if (entry.is_directory()) {
+				indexDirectory(resources, path, index);
+			}
+			else {
+				index.emplace(path, resources.open(path));
+			}
+		}
+	}
+
+	// cmrc looks paths up in an ordered map after normalizing them, the embedded files are listed
+	// once in a hash table instead
+	const EmbeddedIndex& embeddedIndex()
+	{
+		static const EmbeddedIndex index = [] {
+			EmbeddedIndex index;
+			indexDirectory(cmrc::resources::get_filesystem(), "", index);
+			return index;
+		}();
+
+		return index;
+	}
+
+	const cmrc::file* findEmbedded(const std::string& path)
+	{
+		const EmbeddedIndex& index = embeddedIndex();
+		auto it = index.find(path);
+
+		return it != index.end() ? &it->second : nullptr;
+	}
+}
+
+bool Assets::open(const std::string& path, MappedFile& file)
+{
+	if (file.open(path)) {
+		return true;
+	}
+
+	if (const cmrc::file* embedded = findEmbedded(path)) {
+		file.assign(embedded->begin(), embedded->size());
+		return true;
+	}
+
+	return file.open((fs::path(CACHE_DIRECTORY) / path).string());
+}
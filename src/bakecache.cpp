@@ -0,0 +1,187 @@
+#include "bakecache.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include "files.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+	GLenum faceTarget(GLenum target, int face)
+	{
+		return target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+	}
+}
+
+BakeCache::BakeCache(const std::string& directory, uintmax_t maxSize) : mDirectory(directory), mMaxSize(maxSize)
+{
+	std::error_code error;
+	fs::create_directories(mDirectory, error);
+}
+
+bool BakeCache::loadData(const std::string& name, std::vector<char>& data) const
+{
+	std::string path = entryPath(name);
+	MappedFile file;
+
+	if (!file.open(path)) {
+		return false;
+	}
+
+	data.assign(file.data(), file.data() + file.size());
+
+	// Refresh the entry for the LRU eviction
+	std::error_code error;
+	fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+
+	return true;
+}
+
+void BakeCache::storeData(const std::string& name, const void* data, size_t size) const
+{
+	std::string path = entryPath(name);
+
+	if (!Files::writeAtomic(path, data, size)) {
+		std::cout << "Failed to write cache entry " << path << std::endl;
+	}
+}
+
+bool BakeCache::mapLevels(const std::string& name, MappedFile& file, Levels& levels) const
+{
+	std::string path = entryPath(name);
+	size_t blobSize;
+
+	if (!file.open(path) || !levels.map(file.data(), file.size(), blobSize) || blobSize != file.size()) {
+		return false;
+	}
+
+	// Refresh the entry for the LRU eviction
+	std::error_code error;
+	fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+
+	return true;
+}
+
+void BakeCache::writeLevels(const std::string& name, const Levels& levels) const
+{
+	std::vector<char> data;
+	levels.serialize(data);
+
+	storeData(name, data.data(), data.size());
+}
+
+void BakeCache::uploadLevel(const Levels& levels, GLenum target, GLuint id, int mip, int face)
+{
+	GLsizei width = std::max(1, levels.width >> mip);
+	GLsizei height = std::max(1, levels.height >> mip);
+
+	glBindTexture(target, id);
+
+	if (levels.isCompressed()) {
+		glCompressedTexImage2D(faceTarget(target, face), mip, levels.internalFormat, width, height, 0, static_cast<GLsizei>(levels.levelSize(mip)), levels.faceData(mip, face));
+		return;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(faceTarget(target, face), mip, levels.internalFormat, width, height, 0, levels.format, levels.type, levels.faceData(mip, face));
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+bool BakeCache::allocateLevels(GLenum target, GLuint id, int faces, int mipLevels, Levels& levels)
+{
+	GLint internalFormat, width, height;
+	glBindTexture(target, id);
+	glGetTexLevelParameteriv(faceTarget(target, 0), 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+	glGetTexLevelParameteriv(faceTarget(target, 0), 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(faceTarget(target, 0), 0, GL_TEXTURE_HEIGHT, &height);
+
+	if (!levels.setInternalFormat(internalFormat)) {
+		return false;
+	}
+
+	levels.width = width;
+	levels.height = height;
+	levels.faces = faces;
+	levels.mipLevels = mipLevels;
+	levels.data.resize(levels.totalSize());
+
+	return true;
+}
+
+void BakeCache::downloadLevel(Levels& levels, GLenum target, GLuint id, int mip, int face)
+{
+	glBindTexture(target, id);
+
+	if (levels.isCompressed()) {
+		glGetCompressedTexImage(faceTarget(target, face), mip, levels.faceData(mip, face));
+		return;
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(faceTarget(target, face), mip, levels.format, levels.type, levels.faceData(mip, face));
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
+
+bool BakeCache::supportsFormat(GLint internalFormat)
+{
+	switch (internalFormat) {
+	case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB:
+	case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB:
+		return GLAD_GL_ARB_texture_compression_bptc != 0;
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		return GLAD_GL_EXT_texture_compression_s3tc != 0;
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+		return GLAD_GL_EXT_texture_compression_s3tc && GLAD_GL_EXT_texture_sRGB;
+	default:
+		return true;
+	}
+}
+
+std::string BakeCache::entryPath(const std::string& name) const
+{
+	return (fs::path(mDirectory) / name).string();
+}
+
+void BakeCache::evict() const
+{
+	struct Entry
+	{
+		fs::path path;
+		fs::file_time_type time;
+		uintmax_t size;
+	};
+
+	std::vector<Entry> entries;
+	uintmax_t totalSize = 0;
+	std::error_code error;
+
+	for (const auto& item : fs::directory_iterator(mDirectory, error)) {
+		// Temporary files belong to writers still in flight
+		if (item.is_regular_file(error) && item.path().extension() != Files::TEMPORARY_EXTENSION) {
+			Entry entry{ item.path(), item.last_write_time(error), item.file_size(error) };
+			totalSize += entry.size;
+			entries.push_back(entry);
+		}
+	}
+
+	if (totalSize <= mMaxSize) {
+		return;
+	}
+
+	// Oldest first
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		return a.time < b.time;
+	});
+
+	for (const auto& entry : entries) {
+		if (totalSize <= mMaxSize) {
+			break;
+		}
+
+		if (fs::remove(entry.path, error)) {
+			totalSize -= entry.size;
+		}
+	}
+}
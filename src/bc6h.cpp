@@ -0,0 +1,120 @@
+#include "bc6h.h"
+#include <algorithm>
+#include <cmath>
+#include "blockencoding.h"
+
+namespace {
+	const int ENDPOINT_BITS = 10;
+	const int ENDPOINT_MAX = (1 << ENDPOINT_BITS) - 1;
+	const uint32_t MODE_11 = 0x03;
+
+	// The decoder interpolates in a 16-bit domain and scales the result by 31/64 into half
+	// float bits, the encoder works in that domain.
+	const float HALF_TO_DOMAIN = 64.0f / 31.0f;
+
+	typedef BlockEncoding::Block<3> Block;
+
+	int unquantize(int value)
+	{
+		if (value == 0) {
+			return 0;
+		}
+
+		if (value == ENDPOINT_MAX) {
+			return 0xFFFF;
+		}
+
+		return ((value << 16) + 0x8000) >> ENDPOINT_BITS;
+	}
+
+	int quantize(float value)
+	{
+		return std::min(std::max(static_cast<int>(std::lround((value - 32.0f) / 64.0f)), 0), ENDPOINT_MAX);
+	}
+
+	// Unsigned format, negatives clamp to zero and infinities/NaN to the largest finite half
+	float loadHalf(uint16_t half)
+	{
+		if (half & 0x8000u) {
+			return 0.0f;
+		}
+
+		return std::min<uint16_t>(half, 0x7BFFu) * HALF_TO_DOMAIN;
+	}
+
+	void loadBlock(const uint16_t* rgb, int width, int height, int blockX, int blockY, Block& block)
+	{
+		for (int y = 0; y < 4; ++y) {
+			int row = std::min(blockY * 4 + y, height - 1);
+
+			for (int x = 0; x < 4; ++x) {
+				int column = std::min(blockX * 4 + x, width - 1);
+				const uint16_t* texel = rgb + (static_cast<size_t>(row) * width + column) * 3;
+
+				for (int c = 0; c < 3; ++c) {
+					block.texels[y * 4 + x][c] = loadHalf(texel[c]);
+				}
+			}
+		}
+	}
+
+	// Picks the closest palette entry for each texel, returns the total squared error
+	float selectIndices(const Block& block, const int quantized[2][3], int indices[16])
+	{
+		BlockEncoding::Palette<3> palette;
+		for (int c = 0; c < 3; ++c) {
+			int a = unquantize(quantized[0][c]);
+			int b = unquantize(quantized[1][c]);
+
+			for (int i = 0; i < 16; ++i) {
+				palette[c][i] = static_cast<float>((a * (64 - BlockEncoding::WEIGHTS_4BIT[i]) + b * BlockEncoding::WEIGHTS_4BIT[i] + 32) >> 6);
+			}
+		}
+
+		return BlockEncoding::selectIndices<3, 16>(block, palette, 0, indices);
+	}
+
+	void quantizeEndpoints(const float endpoints[2][3], int quantized[2][3])
+	{
+		for (int e = 0; e < 2; ++e) {
+			for (int c = 0; c < 3; ++c) {
+				quantized[e][c] = quantize(endpoints[e][c]);
+			}
+		}
+	}
+}
+
+size_t BC6H::compressedSize(int width, int height)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BLOCK_BYTES;
+}
+
+void BC6H::encodeBlock(const uint16_t* rgb, int width, int height, int blockX, int blockY, uint8_t* block)
+{
+	Block texels;
+	loadBlock(rgb, width, height, blockX, blockY, texels);
+
+	int quantized[2][3];
+	int indices[16];
+
+	BlockEncoding::fitEndpoints<3>(texels, quantized, indices, quantizeEndpoints, selectIndices, [](int index) {
+		return 1.0f - BlockEncoding::WEIGHTS_4BIT[index] / 64.0f;
+	});
+	BlockEncoding::fixAnchor<3>(quantized, indices);
+
+	BlockEncoding::BitWriter writer;
+	writer.write(MODE_11, 5);
+
+	for (int e = 0; e < 2; ++e) {
+		for (int c = 0; c < 3; ++c) {
+			writer.write(quantized[e][c], ENDPOINT_BITS);
+		}
+	}
+
+	writer.write(indices[0], 3);
+	for (int t = 1; t < 16; ++t) {
+		writer.write(indices[t], 4);
+	}
+
+	writer.store(block);
+}
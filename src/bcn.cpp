@@ -0,0 +1,301 @@
+#include "bcn.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "blockencoding.h"
+#include "parallel.h"
+
+namespace {
+	const uint32_t BC7_MODE_6 = 1u << 6;
+
+	// Weight of the first color for each BC1 index
+	const float bc1Weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	typedef BlockEncoding::Block<4> Block;
+
+	// Channels the image doesn't store read as 0, alpha as opaque
+	void loadBlock(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, Block& block)
+	{
+		for (int y = 0; y < 4; ++y) {
+			int row = std::min(blockY * 4 + y, height - 1);
+
+			for (int x = 0; x < 4; ++x) {
+				int column = std::min(blockX * 4 + x, width - 1);
+				const uint8_t* texel = pixels + (static_cast<size_t>(row) * width + column) * channels;
+				float* loaded = block.texels[y * 4 + x];
+
+				for (int c = 0; c < 4; ++c) {
+					loaded[c] = c < channels ? texel[c] : (c == 3 ? 255.0f : 0.0f);
+				}
+			}
+		}
+	}
+
+	int quantizeBC1(const float color[4])
+	{
+		int r = std::min(std::max(static_cast<int>(std::lround(color[0] * 31.0f / 255.0f)), 0), 31);
+		int g = std::min(std::max(static_cast<int>(std::lround(color[1] * 63.0f / 255.0f)), 0), 63);
+		int b = std::min(std::max(static_cast<int>(std::lround(color[2] * 31.0f / 255.0f)), 0), 31);
+
+		return (r << 11) | (g << 5) | b;
+	}
+
+	void quantizeBC1Endpoints(const float endpoints[2][4], int colors[2])
+	{
+		colors[0] = quantizeBC1(endpoints[0]);
+		colors[1] = quantizeBC1(endpoints[1]);
+	}
+
+	float selectBC1Indices(const Block& block, const int colors[2], int indices[16])
+	{
+		BlockEncoding::Palette<3> palette;
+
+		for (int e = 0; e < 2; ++e) {
+			int r = (colors[e] >> 11) & 31;
+			int g = (colors[e] >> 5) & 63;
+			int b = colors[e] & 31;
+			palette[0][e] = static_cast<float>((r << 3) | (r >> 2));
+			palette[1][e] = static_cast<float>((g << 2) | (g >> 4));
+			palette[2][e] = static_cast<float>((b << 3) | (b >> 2));
+		}
+
+		for (int c = 0; c < 3; ++c) {
+			palette[c][2] = (2.0f * palette[c][0] + palette[c][1]) / 3.0f;
+			palette[c][3] = (palette[c][0] + 2.0f * palette[c][1]) / 3.0f;
+		}
+
+		return BlockEncoding::selectIndices<3, 4>(block, palette, 0, indices);
+	}
+
+	// BC7 endpoints are 7 bits per channel plus a shared least significant bit, the p-bit
+	void quantizeBC7(const float endpoint[4], int values[4])
+	{
+		float bestError = 0.0f;
+
+		for (int pBit = 0; pBit < 2; ++pBit) {
+			int candidate[4];
+			float error = 0.0f;
+
+			for (int c = 0; c < 4; ++c) {
+				int quantized = std::min(std::max(static_cast<int>(std::lround((endpoint[c] - pBit) / 2.0f)), 0), 127);
+				candidate[c] = (quantized << 1) | pBit;
+				error += (candidate[c] - endpoint[c]) * (candidate[c] - endpoint[c]);
+			}
+
+			if (pBit == 0 || error < bestError) {
+				bestError = error;
+				memcpy(values, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	void quantizeBC7Endpoints(const float endpoints[2][4], int values[2][4])
+	{
+		quantizeBC7(endpoints[0], values[0]);
+		quantizeBC7(endpoints[1], values[1]);
+	}
+
+	float selectBC7Indices(const Block& block, const int values[2][4], int indices[16])
+	{
+		BlockEncoding::Palette<4> palette;
+
+		for (int c = 0; c < 4; ++c) {
+			for (int i = 0; i < 16; ++i) {
+				palette[c][i] = static_cast<float>((values[0][c] * (64 - BlockEncoding::WEIGHTS_4BIT[i]) + values[1][c] * BlockEncoding::WEIGHTS_4BIT[i] + 32) >> 6);
+			}
+		}
+
+		return BlockEncoding::selectIndices<4, 16>(block, palette, 0, indices);
+	}
+
+	void encodeBlock(GLenum internalFormat, const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, uint8_t* block)
+	{
+		switch (internalFormat) {
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+			BCn::encodeBC1Block(pixels, channels, width, height, blockX, blockY, block);
+			break;
+		case GL_COMPRESSED_RED_RGTC1:
+			BCn::encodeBC4Block(pixels, channels, width, height, blockX, blockY, 0, block);
+			break;
+		case GL_COMPRESSED_RG_RGTC2:
+			BCn::encodeBC5Block(pixels, channels, width, height, blockX, blockY, block);
+			break;
+		case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB:
+		case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB:
+			BCn::encodeBC7Block(pixels, channels, width, height, blockX, blockY, block);
+			break;
+		}
+	}
+}
+
+void BCn::encodeBC1Block(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, uint8_t* block)
+{
+	Block texels;
+	loadBlock(pixels, channels, width, height, blockX, blockY, texels);
+
+	int colors[2];
+	int indices[16];
+
+	BlockEncoding::fitEndpoints<3>(texels, colors, indices, quantizeBC1Endpoints, selectBC1Indices, [](int index) {
+		return bc1Weights[index];
+	});
+
+	// The four color mode needs the first color to be greater, equal colors only use index 0
+	if (colors[0] < colors[1]) {
+		std::swap(colors[0], colors[1]);
+
+		for (int t = 0; t < 16; ++t) {
+			indices[t] ^= 1;
+		}
+	}
+	else if (colors[0] == colors[1]) {
+		std::fill(indices, indices + 16, 0);
+	}
+
+	uint32_t bits = 0;
+	for (int t = 0; t < 16; ++t) {
+		bits |= static_cast<uint32_t>(indices[t]) << (t * 2);
+	}
+
+	block[0] = static_cast<uint8_t>(colors[0]);
+	block[1] = static_cast<uint8_t>(colors[0] >> 8);
+	block[2] = static_cast<uint8_t>(colors[1]);
+	block[3] = static_cast<uint8_t>(colors[1] >> 8);
+
+	for (int i = 0; i < 4; ++i) {
+		block[4 + i] = static_cast<uint8_t>(bits >> (i * 8));
+	}
+}
+
+void BCn::encodeBC4Block(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, int channel, uint8_t* block)
+{
+	Block texels;
+	loadBlock(pixels, channels, width, height, blockX, blockY, texels);
+
+	float low = 255.0f;
+	float high = 0.0f;
+	for (int t = 0; t < 16; ++t) {
+		low = std::min(low, texels.texels[t][channel]);
+		high = std::max(high, texels.texels[t][channel]);
+	}
+
+	// The range always uses the eight value mode, a flat block only needs index 0
+	int endpoints[2] = { static_cast<int>(high), static_cast<int>(low) };
+	uint64_t bits = 0;
+
+	if (endpoints[0] > endpoints[1]) {
+		BlockEncoding::Palette<1> palette;
+		palette[0][0] = static_cast<float>(endpoints[0]);
+		palette[0][1] = static_cast<float>(endpoints[1]);
+
+		for (int i = 2; i < 8; ++i) {
+			palette[0][i] = ((8 - i) * endpoints[0] + (i - 1) * endpoints[1]) / 7.0f;
+		}
+
+		int indices[16];
+		BlockEncoding::selectIndices<1, 8>(texels, palette, channel, indices);
+
+		for (int t = 0; t < 16; ++t) {
+			bits |= static_cast<uint64_t>(indices[t]) << (t * 3);
+		}
+	}
+
+	block[0] = static_cast<uint8_t>(endpoints[0]);
+	block[1] = static_cast<uint8_t>(endpoints[1]);
+
+	for (int i = 0; i < 6; ++i) {
+		block[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+	}
+}
+
+void BCn::encodeBC5Block(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, uint8_t* block)
+{
+	encodeBC4Block(pixels, channels, width, height, blockX, blockY, 0, block);
+	encodeBC4Block(pixels, channels, width, height, blockX, blockY, 1, block + BC4_BLOCK_BYTES);
+}
+
+void BCn::encodeBC7Block(const uint8_t* pixels, int channels, int width, int height, int blockX, int blockY, uint8_t* block)
+{
+	Block texels;
+	loadBlock(pixels, channels, width, height, blockX, blockY, texels);
+
+	int values[2][4];
+	int indices[16];
+
+	BlockEncoding::fitEndpoints<4>(texels, values, indices, quantizeBC7Endpoints, selectBC7Indices, [](int index) {
+		return 1.0f - BlockEncoding::WEIGHTS_4BIT[index] / 64.0f;
+	});
+	BlockEncoding::fixAnchor<4>(values, indices);
+
+	BlockEncoding::BitWriter writer;
+	writer.write(BC7_MODE_6, 7);
+
+	for (int c = 0; c < 4; ++c) {
+		for (int e = 0; e < 2; ++e) {
+			writer.write(values[e][c] >> 1, 7);
+		}
+	}
+
+	writer.write(values[0][0] & 1, 1);
+	writer.write(values[1][0] & 1, 1);
+
+	writer.write(indices[0], 3);
+	for (int t = 1; t < 16; ++t) {
+		writer.write(indices[t], 4);
+	}
+
+	writer.store(block);
+}
+
+bool BCn::compressLevels(const TextureLevels& source, GLenum internalFormat, TextureLevels& target)
+{
+	if (source.type != GL_UNSIGNED_BYTE || (source.format != GL_RED && source.format != GL_RG && source.format != GL_RGBA)) {
+		return false;
+	}
+
+	int channels = static_cast<int>(source.bytesPerPixel);
+
+	switch (internalFormat) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RED_RGTC1:
+	case GL_COMPRESSED_RG_RGTC2:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB:
+	case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB:
+		break;
+	default:
+		return false;
+	}
+
+	target.setInternalFormat(internalFormat);
+
+	BlockEncoding::compressLevels(source, target, [&](const char* pixels, int width, int height, int blockX, int blockY, uint8_t* block) {
+		encodeBlock(internalFormat, reinterpret_cast<const uint8_t*>(pixels), channels, width, height, blockX, blockY, block);
+	});
+
+	return true;
+}
+
+void BCn::compressRegion(const TextureLevels& source, int mip, int x, int y, int width, int height, TextureLevels& target)
+{
+	int mipWidth = std::max(1, source.width >> mip);
+	int mipHeight = std::max(1, source.height >> mip);
+	int blocksX = (mipWidth + 3) / 4;
+	int firstX = x / 4;
+	int firstY = y / 4;
+	int regionBlocksX = (x + width + 3) / 4 - firstX;
+	int regionBlocksY = (y + height + 3) / 4 - firstY;
+
+	const uint8_t* pixels = reinterpret_cast<const uint8_t*>(source.faceData(mip, 0));
+	uint8_t* blocks = reinterpret_cast<uint8_t*>(target.faceData(mip, 0));
+
+	parallelFor(static_cast<size_t>(regionBlocksX) * regionBlocksY, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			int blockX = firstX + static_cast<int>(i % regionBlocksX);
+			int blockY = firstY + static_cast<int>(i / regionBlocksX);
+			uint8_t* output = blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * target.bytesPerPixel;
+			encodeBlock(target.internalFormat, pixels, static_cast<int>(source.bytesPerPixel), mipWidth, mipHeight, blockX, blockY, output);
+		}
+	});
+}
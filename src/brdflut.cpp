@@ -0,0 +1,89 @@
+#include "brdflut.h"
+#include "halffloat.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const float PI = 3.14159265359f;
+
+	// efficient Van Der Corput calculation.
+	float radicalInverseVdC(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(bits) * 2.3283064365386963e-10f; // / 0x100000000
+	}
+
+	float geometrySchlickGGX(float NdotV, float roughness)
+	{
+		float k = (roughness * roughness) / 2.0f;
+		return NdotV / (NdotV * (1.0f - k) + k);
+	}
+}
+
+std::vector<uint16_t> BrdfLUT::integrate(int resolution)
+{
+	std::vector<uint16_t> lut(static_cast<size_t>(resolution) * resolution * 2);
+
+	parallelFor(static_cast<size_t>(resolution), [&](size_t begin, size_t end) {
+		// Half vectors only depend on the roughness, so they're shared by the whole row.
+		// Structure of arrays keeps the per texel loop branch free for the vectorizer.
+		std::vector<float> hx(SAMPLE_COUNT), hy(SAMPLE_COUNT), hz(SAMPLE_COUNT);
+
+		for (size_t y = begin; y < end; ++y) {
+			float roughness = (y + 0.5f) / resolution;
+			float a = roughness * roughness;
+
+			for (unsigned int i = 0; i < SAMPLE_COUNT; ++i) {
+				float xiX = static_cast<float>(i) / SAMPLE_COUNT;
+				float xiY = radicalInverseVdC(i);
+				float phi = 2.0f * PI * xiX;
+				float cosTheta = std::sqrt((1.0f - xiY) / (1.0f + (a * a - 1.0f) * xiY));
+				float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+				// Same tangent frame as ImportanceSampleGGX with N = (0, 0, 1)
+				hx[i] = std::sin(phi) * sinTheta;
+				hy[i] = -std::cos(phi) * sinTheta;
+				hz[i] = cosTheta;
+			}
+
+			for (int x = 0; x < resolution; ++x) {
+				float NdotV = (x + 0.5f) / resolution;
+				float vx = std::sqrt(1.0f - NdotV * NdotV);
+				float vz = NdotV;
+				float ggxV = geometrySchlickGGX(NdotV, roughness);
+				float k = (roughness * roughness) / 2.0f;
+				float A = 0.0f;
+				float B = 0.0f;
+
+				for (unsigned int i = 0; i < SAMPLE_COUNT; ++i) {
+					float VdotH = vx * hx[i] + vz * hz[i];
+					float lz = 2.0f * VdotH * hz[i] - vz;
+					float NdotL = std::max(lz, 0.0f);
+					float NdotH = std::max(hz[i], 0.0f);
+					VdotH = std::max(VdotH, 0.0f);
+
+					float ggxL = NdotL / (NdotL * (1.0f - k) + k);
+					float G = ggxL * ggxV;
+					float GVis = (G * VdotH) / (NdotH * NdotV);
+					float f = 1.0f - VdotH;
+					float Fc = (f * f) * (f * f) * f;
+					float mask = lz > 0.0f ? 1.0f : 0.0f;
+
+					A += mask * (1.0f - Fc) * GVis;
+					B += mask * Fc * GVis;
+				}
+
+				size_t texel = (y * resolution + x) * 2;
+				lut[texel] = HalfFloat::fromFloat(A / SAMPLE_COUNT);
+				lut[texel + 1] = HalfFloat::fromFloat(B / SAMPLE_COUNT);
+			}
+		}
+	});
+
+	return lut;
+}
@@ -0,0 +1,41 @@
+#include "channels.h"
+#include "simd.h"
+
+void Channels::extract(const uint8_t* rgba, size_t texelCount, int channels, uint8_t* output)
+{
+	size_t i = 0;
+
+#ifdef PBR_SSE2
+	// Each texel is one 32-bit lane, the kept bytes are narrowed with saturating packs
+	// that can't saturate once the other bytes are cleared
+	if (channels == 1) {
+		const __m128i mask = _mm_set1_epi32(0xFF);
+
+		for (; i + 16 <= texelCount; i += 16) {
+			const __m128i* source = reinterpret_cast<const __m128i*>(rgba + i * 4);
+			__m128i a = _mm_and_si128(_mm_loadu_si128(source), mask);
+			__m128i b = _mm_and_si128(_mm_loadu_si128(source + 1), mask);
+			__m128i c = _mm_and_si128(_mm_loadu_si128(source + 2), mask);
+			__m128i d = _mm_and_si128(_mm_loadu_si128(source + 3), mask);
+			__m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), packed);
+		}
+	}
+	else if (channels == 2) {
+		for (; i + 8 <= texelCount; i += 8) {
+			const __m128i* source = reinterpret_cast<const __m128i*>(rgba + i * 4);
+
+			// Sign extending the low 16 bits keeps them through the signed pack
+			__m128i a = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128(source), 16), 16);
+			__m128i b = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128(source + 1), 16), 16);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 2), _mm_packs_epi32(a, b));
+		}
+	}
+#endif
+
+	for (; i < texelCount; ++i) {
+		for (int c = 0; c < channels; ++c) {
+			output[i * channels + c] = rgba[i * 4 + c];
+		}
+	}
+}
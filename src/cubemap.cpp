@@ -23,6 +23,42 @@ void CubeMap::bind(GLenum textureUnit) const
 	glBindTexture(GL_TEXTURE_CUBE_MAP, mID);
 }
 
+const std::string& CubeMap::getCacheKey() const
+{
+	return mCacheKey;
+}
+
+void CubeMap::setCacheKey(const std::string& cacheKey)
+{
+	mCacheKey = cacheKey;
+}
+
+void CubeMap::setBakedLevels(int firstLevel, int lastLevel)
+{
+	mFirstBakedLevel = firstLevel;
+	mLastBakedLevel = lastLevel;
+
+	// The LOD range rather than the base level, textureLod keeps addressing mips from level 0
+	bind(GL_TEXTURE0);
+	glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_LOD, static_cast<float>(firstLevel));
+	glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LOD, static_cast<float>(lastLevel));
+}
+
+int CubeMap::getFirstBakedLevel() const
+{
+	return mFirstBakedLevel;
+}
+
+int CubeMap::getLastBakedLevel() const
+{
+	return mLastBakedLevel;
+}
+
+bool CubeMap::hasBakedLevels(int firstLevel, int lastLevel) const
+{
+	return firstLevel >= mFirstBakedLevel && lastLevel <= mLastBakedLevel;
+}
+
 void CubeMap::release()
 {
 	glDeleteTextures(1, &mID);
@@ -1,20 +1,21 @@
 #include "cubemapgenerator.h"
-#include <stb_image.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
-#include <cmrc\cmrc.hpp>
-CMRC_DECLARE(resources);
 
-#include "cubemap.h"
-#include "shader.h"
+#include "assets.h"
+#include "brdflut.h"
+#include "hash.h"
+#include "sharedexponent.h"
+#include "shprojection.h"
+#include "uniformblocks.h"
 
 namespace {
-	const int envRes = 1024;
-	const int irrRes = 64;
-	const int prefilterRes = 1024;
-	const int brdfLUTRes = 512;
+	// Past the blocks shared by every program
+	const GLuint samplesBindingPoint = UniformBlocks::MATERIAL_BINDING_POINT + 1;
 
 	glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
 	glm::mat4 captureViews[] =
@@ -26,248 +27,241 @@ namespace {
 		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
 		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
 	};
+
+	void setCubeMapParameters(bool mipmapped)
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	void beginCapture(GLuint captureFBO, int size)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+		glViewport(0, 0, size, size);
+
+		glDisable(GL_CULL_FACE);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_STENCIL_TEST);
+	}
 }
 
 CubeMapGenerator::CubeMapGenerator()
 {
 	mSkybox = std::make_unique<Skybox>();
-	mQuad = std::make_unique<Quad>();
+	mEquirectangularShader = std::make_unique<Shader>("shaders/shadercubemap.vs", "shaders/shaderequirectangular.fs");
+	mPreFilterShader = std::make_unique<Shader>("shaders/shadercubemap.vs", "shaders/shaderprefilter.fs");
+
+	glGenFramebuffers(1, &mCaptureFBO);
+	glGenBuffers(1, &mSamplesUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, mSamplesUBO);
+	glBufferData(GL_UNIFORM_BUFFER, PrefilterSamples::MAX_SAMPLES * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	mEquirectangularShader->use();
+	mEquirectangularShader->setInt("equirectangularMap", 0);
+	mEquirectangularShader->setMat4("projection", captureProjection);
+
+	mPreFilterShader->use();
+	mPreFilterShader->setInt("environmentMap", 0);
+	mPreFilterShader->setMat4("projection", captureProjection);
+	mPreFilterShader->setUniformBlock("PrefilterSamples", samplesBindingPoint);
 }
 
 CubeMapGenerator::~CubeMapGenerator()
 {
+	glDeleteTextures(1, &mHdrTextureID);
+	glDeleteBuffers(1, &mSamplesUBO);
+	glDeleteFramebuffers(1, &mCaptureFBO);
 }
 
-std::shared_ptr<CubeMap> CubeMapGenerator::generateEnvironmentMap(const GLchar* imagePath)
+std::string CubeMapGenerator::sourceCacheKey(const MappedFile& imageFile)
 {
-	std::shared_ptr<CubeMap> environmentMap = std::make_shared<CubeMap>();
-
-	// Load equirectangular hdr image
-	stbi_set_flip_vertically_on_load(true);
-	int width, height, nrComponents;
-	float *data = stbi_loadf(imagePath, &width, &height, &nrComponents, 3);
-
-	if (!data) {
-		// Fall back to embedded resources
-		auto fs = cmrc::resources::get_filesystem();
-		if (fs.exists(imagePath)) {
-			auto envRes = fs.open(imagePath);
-			std::string str(envRes.begin(), envRes.size());
-			data = stbi_loadf_from_memory((const unsigned char*)str.c_str(), str.size(), &width, &height, &nrComponents, 3);
-		}
+	// The source pixels and the shaders used, the settings of each map are added on top
+	uint64_t hash = Hash::fnv1a(imageFile.data(), imageFile.size());
+
+	for (const GLchar* shaderPath : { "shaders/shadercubemap.vs", "shaders/shaderequirectangular.fs", "shaders/shaderprefilter.fs" }) {
+		std::string source = Shader::readSource(shaderPath);
+		hash = Hash::fnv1a(source.data(), source.size(), hash);
 	}
 
-	if (data)
-	{
-		// Framebuffer setup
-		unsigned int captureFBO, captureRBO;
-		glGenFramebuffers(1, &captureFBO);
-		glGenRenderbuffers(1, &captureRBO);
+	return Hash::toHex(hash);
+}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-		glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envRes, envRes);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-		unsigned int hdrTextureID;
-		glGenTextures(1, &hdrTextureID);
-		glBindTexture(GL_TEXTURE_2D, hdrTextureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// Generate environment cubemap
-		environmentMap->bind(GL_TEXTURE0);
-
-		for (unsigned int i = 0; i < 6; ++i)
-		{
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, envRes, envRes, 0, GL_RGB, GL_FLOAT, nullptr);
-		}
+std::string CubeMapGenerator::environmentCacheKey(const std::string& sourceKey, const IblQuality::Settings& settings)
+{
+	// The irradiance SH is derived from the environment map, it shares this key
+	const int values[] = { settings.environmentResolution, settings.environmentMipLevels, static_cast<int>(settings.environmentFormat), SHProjection::SOURCE_RESOLUTION };
+	uint64_t hash = Hash::fnv1a(sourceKey.data(), sourceKey.size());
+	hash = Hash::fnv1a(values, sizeof(values), hash);
 
-		mSkybox->setEnvironmentMap(environmentMap);
+	return Hash::toHex(hash);
+}
 
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+std::string CubeMapGenerator::preFilterCacheKey(const std::string& environmentKey, const IblQuality::Settings& settings)
+{
+	const int values[] = { settings.preFilterResolution, settings.preFilterMipLevels, static_cast<int>(settings.preFilterFormat) };
+	uint64_t hash = Hash::fnv1a(environmentKey.data(), environmentKey.size());
+	hash = Hash::fnv1a(values, sizeof(values), hash);
 
-		// convert HDR equirectangular environment map to cubemap equivalent
-		Shader equirectangularToCubemapShader("shaders/shadercubemap.vs", "shaders/shaderequirectangular.fs");
-		equirectangularToCubemapShader.use();
-		equirectangularToCubemapShader.setInt("equirectangularMap", 0);
-		equirectangularToCubemapShader.setMat4("projection", captureProjection);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, hdrTextureID);
+	for (int mip = 0; mip < settings.preFilterMipLevels; ++mip) {
+		unsigned int sampleCount = PrefilterSamples::sampleCount(mip);
+		hash = Hash::fnv1a(&sampleCount, sizeof(sampleCount), hash);
+	}
 
-		glViewport(0, 0, envRes, envRes);
-		glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	return Hash::toHex(hash);
+}
 
-		glDisable(GL_CULL_FACE);
-		glDisable(GL_DEPTH_TEST);
-		glDisable(GL_STENCIL_TEST);
+std::shared_ptr<CubeMap> CubeMapGenerator::createCubeMap(GLenum internalFormat, int resolution, int mipLevels) const
+{
+	std::shared_ptr<CubeMap> cubeMap = std::make_shared<CubeMap>();
+	cubeMap->bind(GL_TEXTURE0);
 
-		for (unsigned int i = 0; i < 6; ++i)
-		{
-			equirectangularToCubemapShader.setMat4("view", captureViews[i]);
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, environmentMap->getId(), 0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	for (int mip = 0; mip < mipLevels; ++mip) {
+		int mipRes = std::max(1, resolution >> mip);
 
-			mSkybox->draw(equirectangularToCubemapShader);
+		for (unsigned int i = 0; i < 6; ++i) {
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, internalFormat, mipRes, mipRes, 0, GL_RGB, GL_FLOAT, nullptr);
 		}
+	}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	setCubeMapParameters(mipLevels > 1);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
 
-		environmentMap->bind(GL_TEXTURE0);
-		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	return cubeMap;
+}
 
-		// Clean up
-		glDeleteTextures(1, &hdrTextureID);
-		glDeleteRenderbuffers(1, &captureRBO);
-		glDeleteFramebuffers(1, &captureFBO);
-	}
-	else
-	{
-		std::cout << "Failed to load HDR image." << std::endl;
-	}
+std::shared_ptr<CubeMap> CubeMapGenerator::createEnvironmentMap(const IblQuality::Settings& settings) const
+{
+	return createCubeMap(IblQuality::renderFormat(settings.environmentFormat), settings.environmentResolution, settings.environmentMipLevels);
+}
 
-	stbi_image_free(data);
+void CubeMapGenerator::uploadEquirectangular(const EquirectangularImage& image)
+{
+	glDeleteTextures(1, &mHdrTextureID);
+	glGenTextures(1, &mHdrTextureID);
+	glBindTexture(GL_TEXTURE_2D, mHdrTextureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, image.width, image.height, 0, GL_RGB, GL_HALF_FLOAT, image.pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-	return environmentMap;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
-std::shared_ptr<CubeMap> CubeMapGenerator::generateIrradianceMap(const std::shared_ptr<CubeMap> environmentMap)
+void CubeMapGenerator::renderEnvironmentFace(const IblQuality::Settings& settings, const CubeMap& environmentMap, int face)
 {
-	std::shared_ptr<CubeMap> irradianceMap = std::make_shared<CubeMap>();
+	// convert HDR equirectangular environment map to cubemap equivalent
+	mEquirectangularShader->use();
+	mEquirectangularShader->setMat4("view", captureViews[face]);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, mHdrTextureID);
 
-	irradianceMap->bind(GL_TEXTURE0);
+	beginCapture(mCaptureFBO, settings.environmentResolution);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, environmentMap.getId(), 0);
+	glClear(GL_COLOR_BUFFER_BIT);
 
-	for (unsigned int i = 0; i < 6; ++i) {
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, irrRes, irrRes, 0, GL_RGB, GL_FLOAT, nullptr);
-	}
+	mSkybox->setEnvironmentMap(nullptr);
+	mSkybox->draw(*mEquirectangularShader);
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-	// Framebuffer setup
-	unsigned int captureFBO, captureRBO;
-	glGenFramebuffers(1, &captureFBO);
-	glGenRenderbuffers(1, &captureRBO);
+void CubeMapGenerator::finishEnvironmentMap(const CubeMap& environmentMap)
+{
+	environmentMap.bind(GL_TEXTURE0);
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, irrRes, irrRes);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
+	// The equirectangular source isn't needed anymore
+	glDeleteTextures(1, &mHdrTextureID);
+	mHdrTextureID = 0;
+}
 
-	// convert HDR equirectangular environment map to cubemap equivalent
-	Shader irradianceShader("shaders/shadercubemap.vs", "shaders/shaderirradiance.fs");
-	irradianceShader.use();
-	irradianceShader.setInt("environmentMap", 0);
-	irradianceShader.setMat4("projection", captureProjection);
+std::shared_ptr<SphericalHarmonics> CubeMapGenerator::generateIrradianceSH(const IblQuality::Settings& settings, const std::shared_ptr<CubeMap> environmentMap)
+{
+	std::shared_ptr<SphericalHarmonics> irradianceSH = std::make_shared<SphericalHarmonics>();
 
-	mSkybox->setEnvironmentMap(environmentMap);
+	// Project a low mip of the environment
+	int mip = SHProjection::sourceMip(settings.environmentResolution, settings.environmentMipLevels);
 
-	glViewport(0, 0, irrRes, irrRes); // don't forget to configure the viewport to the capture dimensions.
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	int faceRes = settings.environmentResolution >> mip;
+	size_t faceSize = static_cast<size_t>(4 * faceRes * faceRes);
+	std::vector<float> faces(6 * faceSize);
 
-	glDisable(GL_CULL_FACE);
-	glDisable(GL_DEPTH_TEST);
-	glDisable(GL_STENCIL_TEST);
+	environmentMap->bind(GL_TEXTURE0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
 
 	for (unsigned int i = 0; i < 6; ++i) {
-		irradianceShader.setMat4("view", captureViews[i]);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap->getId(), 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		mSkybox->draw(irradianceShader);
+		glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, GL_RGBA, GL_FLOAT, faces.data() + i * faceSize);
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	// Clean up
-	glDeleteRenderbuffers(1, &captureRBO);
-	glDeleteFramebuffers(1, &captureFBO);
+	irradianceSH->setCoefficients(SHProjection::projectCubeMap(faces.data(), faceRes));
 
-	return irradianceMap;
+	return irradianceSH;
 }
 
-std::shared_ptr<CubeMap> CubeMapGenerator::generatePreFilterMap(const std::shared_ptr<CubeMap> environmentMap)
+std::shared_ptr<CubeMap> CubeMapGenerator::createPreFilterMap(const IblQuality::Settings& settings) const
 {
-	std::shared_ptr<CubeMap> preFilterMap = std::make_shared<CubeMap>();
-
-	preFilterMap->bind(GL_TEXTURE0);
+	return createCubeMap(IblQuality::renderFormat(settings.preFilterFormat), settings.preFilterResolution, settings.preFilterMipLevels);
+}
 
-	for (unsigned int i = 0; i < 6; ++i) {
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, prefilterRes, prefilterRes, 0, GL_RGB, GL_FLOAT, nullptr);
+void CubeMapGenerator::renderPreFilterFace(const IblQuality::Settings& settings, const std::shared_ptr<CubeMap> environmentMap, const CubeMap& preFilterMap, int mip, int face)
+{
+	updateSampleTables(settings);
+	const PrefilterSamples::Table& table = mSampleTables[mip];
+
+	mPreFilterShader->use();
+	glBindBufferBase(GL_UNIFORM_BUFFER, samplesBindingPoint, mSamplesUBO);
+
+	if (mBoundSampleMip != mip) {
+		glBindBuffer(GL_UNIFORM_BUFFER, mSamplesUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, table.samples.size() * sizeof(glm::vec4), table.samples.data());
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		mPreFilterShader->setInt("sampleCount", static_cast<int>(table.samples.size()));
+		mPreFilterShader->setFloat("invTotalWeight", 1.0f / table.totalWeight);
+		mBoundSampleMip = mip;
 	}
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-	// Framebuffer setup
-	unsigned int captureFBO, captureRBO;
-	glGenFramebuffers(1, &captureFBO);
-	glGenRenderbuffers(1, &captureRBO);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, prefilterRes, prefilterRes);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
+	mPreFilterShader->setMat4("view", captureViews[face]);
 
-	// convert HDR equirectangular environment map to cubemap equivalent
-	Shader prefilterShader("shaders/shadercubemap.vs", "shaders/shaderprefilter.fs");
-	prefilterShader.use();
-	prefilterShader.setInt("environmentMap", 0);
-	prefilterShader.setMat4("projection", captureProjection);
-	prefilterShader.setInt("envRes", envRes);
+	beginCapture(mCaptureFBO, std::max(1, settings.preFilterResolution >> mip));
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, preFilterMap.getId(), mip);
+	glClear(GL_COLOR_BUFFER_BIT);
 
 	mSkybox->setEnvironmentMap(environmentMap);
+	mSkybox->draw(*mPreFilterShader);
 
-	glViewport(0, 0, prefilterRes, prefilterRes); // don't forget to configure the viewport to the capture dimensions.
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-
-	glDisable(GL_CULL_FACE);
-	glDisable(GL_DEPTH_TEST);
-	glDisable(GL_STENCIL_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-	unsigned int maxMipLevels = 5;
-	for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
-	{
-		// reisze framebuffer according to mip-level size.
-		unsigned int mipWidth = static_cast<unsigned int>(prefilterRes * std::pow(0.5, mip));
-		unsigned int mipHeight = static_cast<unsigned int>(prefilterRes * std::pow(0.5, mip));
-		glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-		glViewport(0, 0, mipWidth, mipHeight);
+void CubeMapGenerator::packLevel(const CubeMap& source, const CubeMap& target, GLenum internalFormat, int resolution, int mip, int face)
+{
+	int mipRes = std::max(1, resolution >> mip);
+	std::vector<float> pixels(static_cast<size_t>(mipRes) * mipRes * 3);
 
-		float roughness = (float)mip / (float)(maxMipLevels - 1);
-		prefilterShader.setFloat("roughness", roughness);
+	source.bind(GL_TEXTURE0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB, GL_FLOAT, pixels.data());
 
-		for (unsigned int i = 0; i < 6; ++i) {
-			prefilterShader.setMat4("view", captureViews[i]);
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, preFilterMap->getId(), mip);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			mSkybox->draw(prefilterShader);
-		}
-	}
+	target.bind(GL_TEXTURE0);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (internalFormat == GL_RGB9_E5) {
+		// Packed on the CPU, shared exponent can't be a render target
+		std::vector<uint32_t> texels(static_cast<size_t>(mipRes) * mipRes);
 
-	// Clean up
-	glDeleteRenderbuffers(1, &captureRBO);
-	glDeleteFramebuffers(1, &captureFBO);
+		for (size_t i = 0; i < texels.size(); ++i) {
+			texels[i] = SharedExponent::fromRGB(pixels[i * 3], pixels[i * 3 + 1], pixels[i * 3 + 2]);
+		}
 
-	return preFilterMap;
+		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, 0, 0, mipRes, mipRes, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, texels.data());
+	}
+	else {
+		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, 0, 0, mipRes, mipRes, GL_RGB, GL_FLOAT, pixels.data());
+	}
 }
 
 std::shared_ptr<Texture> CubeMapGenerator::generateBrdfLUT()
@@ -275,37 +269,42 @@ std::shared_ptr<Texture> CubeMapGenerator::generateBrdfLUT()
 	std::shared_ptr<Texture> brdfMap = std::make_shared<Texture>();
 	brdfMap->bind(GL_TEXTURE0);
 
-	// pre-allocate enough memory for the LUT texture.
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, brdfLUTRes, brdfLUTRes, 0, GL_RG, GL_FLOAT, 0);
-
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	// Framebuffer setup
-	unsigned int captureFBO, captureRBO;
-	glGenFramebuffers(1, &captureFBO);
-	glGenRenderbuffers(1, &captureRBO);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, brdfLUTRes, brdfLUTRes);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfMap->getId(), 0);
+	// Integrated at build time by brdf_lut_gen, see BrdfLUT::integrate
+	MappedFile lutFile;
+	size_t expectedSize = static_cast<size_t>(BrdfLUT::RESOLUTION) * BrdfLUT::RESOLUTION * 2 * sizeof(uint16_t);
 
-	glViewport(0, 0, brdfLUTRes, brdfLUTRes);
+	if (Assets::open("textures/brdf_lut.bin", lutFile) && lutFile.size() == expectedSize) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, BrdfLUT::RESOLUTION, BrdfLUT::RESOLUTION, 0, GL_RG, GL_HALF_FLOAT, lutFile.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	else {
+		std::cout << "Failed to load BRDF LUT." << std::endl;
+	}
 
-	// Render quad
-	Shader brdfShader("shaders/shaderbrdf.vs", "shaders/shaderbrdf.fs");
-	brdfShader.use();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	mQuad->draw(brdfShader);
+	return brdfMap;
+}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+const BakeCache& CubeMapGenerator::getBakeCache() const
+{
+	return mBakeCache;
+}
 
-	// Clean up
-	glDeleteRenderbuffers(1, &captureRBO);
-	glDeleteFramebuffers(1, &captureFBO);
+void CubeMapGenerator::updateSampleTables(const IblQuality::Settings& settings)
+{
+	if (mSampleTablesEnvironmentResolution == settings.environmentResolution && mSampleTablesPreFilterResolution == settings.preFilterResolution
+		&& static_cast<int>(mSampleTables.size()) == settings.preFilterMipLevels) {
+		return;
+	}
 
-	return brdfMap;
-}
\ No newline at end of file
+	// Importance sample tables, uploaded per roughness level
+	mSampleTables = PrefilterSamples::generateMips(settings.preFilterMipLevels, settings.environmentResolution, settings.preFilterResolution);
+	mSampleTablesEnvironmentResolution = settings.environmentResolution;
+	mSampleTablesPreFilterResolution = settings.preFilterResolution;
+	mBoundSampleMip = -1;
+}
@@ -0,0 +1,588 @@
+#include "environmentbake.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "assets.h"
+#include "iblcontainer.h"
+#include "shprojection.h"
+
+namespace {
+	const int ENVIRONMENT_FACES = 6;
+
+	bool validLevels(const BakeCache::Levels& levels, GLenum internalFormat, int resolution, int mipLevels)
+	{
+		return levels.faces == ENVIRONMENT_FACES && levels.internalFormat == static_cast<GLint>(internalFormat)
+			&& levels.width == resolution && levels.mipLevels == mipLevels;
+	}
+}
+
+EnvironmentBake::EnvironmentBake(CubeMapGenerator& generator, const std::string& imagePath, const IblQuality::Settings& settings,
+	std::shared_ptr<CubeMap> currentEnvironmentMap, std::shared_ptr<SphericalHarmonics> currentIrradianceSH,
+	std::shared_ptr<CubeMap> currentPreFilterMap, const glm::vec2& roughnessRange)
+	: mGenerator(generator), mImagePath(imagePath), mSettings(settings), mRoughnessRange(roughnessRange)
+{
+	mDecodeState = std::make_shared<DecodeState>();
+
+	// Kept until schedule() knows whether they can be reused
+	mEnvironmentMap = currentEnvironmentMap;
+	mIrradianceSH = currentIrradianceSH;
+	mPreFilterMap = currentPreFilterMap;
+
+	std::string currentEnvironmentKey = currentEnvironmentMap && currentIrradianceSH ? currentEnvironmentMap->getCacheKey() : "";
+	std::string currentPreFilterKey = currentPreFilterMap ? currentPreFilterMap->getCacheKey() : "";
+
+	glGenQueries(TIMER_QUERIES, mTimerQueries);
+
+	// The worker owns a copy of the cache and a reference to the state
+	std::shared_ptr<DecodeState> state = mDecodeState;
+	BakeCache bakeCache = generator.getBakeCache();
+
+	startWorker([state, bakeCache, imagePath, settings, currentEnvironmentKey, currentPreFilterKey]() {
+		MappedFile& imageFile = state->imageFile;
+		state->settings = settings;
+
+		if (Assets::open(imagePath, imageFile)) {
+			// Containers baked by pbr_bake come with their own settings
+			IblContainer::Contents contents;
+			bool container = IblContainer::isContainer(imagePath);
+
+			if (container && IblContainer::read(imageFile.data(), imageFile.size(), contents)) {
+				state->settings = IblContainer::settings(contents);
+			}
+
+			std::string sourceKey = CubeMapGenerator::sourceCacheKey(imageFile);
+			state->environmentKey = CubeMapGenerator::environmentCacheKey(sourceKey, state->settings);
+			state->preFilterKey = CubeMapGenerator::preFilterCacheKey(state->environmentKey, state->settings);
+			state->environmentReused = !state->environmentKey.empty() && state->environmentKey == currentEnvironmentKey;
+			state->preFilterReused = !state->preFilterKey.empty() && state->preFilterKey == currentPreFilterKey;
+
+			if (container) {
+				bool supported = !contents.environment.isEmpty() && !contents.preFilter.isEmpty()
+					&& BakeCache::supportsFormat(contents.environment.internalFormat) && BakeCache::supportsFormat(contents.preFilter.internalFormat);
+
+				state->environmentLevels = std::move(contents.environment);
+				state->preFilterLevels = std::move(contents.preFilter);
+				state->shData.resize(sizeof(SHProjection::Coefficients));
+				memcpy(state->shData.data(), contents.irradianceSH.data(), sizeof(SHProjection::Coefficients));
+				state->environmentCached = state->shCached = state->preFilterCached = true;
+				state->succeeded = supported;
+			}
+			else {
+				if (!state->environmentReused) {
+					state->environmentCached = bakeCache.mapLevels(state->environmentKey + ".env", state->environmentFile, state->environmentLevels)
+						&& validLevels(state->environmentLevels, settings.environmentFormat, settings.environmentResolution, settings.environmentMipLevels);
+					state->shCached = bakeCache.loadData(state->environmentKey + ".sh", state->shData)
+						&& state->shData.size() == sizeof(SHProjection::Coefficients);
+				}
+
+				if (!state->preFilterReused) {
+					state->preFilterCached = bakeCache.mapLevels(state->preFilterKey + ".prefilter", state->preFilterFile, state->preFilterLevels)
+						&& validLevels(state->preFilterLevels, settings.preFilterFormat, settings.preFilterResolution, settings.preFilterMipLevels);
+				}
+
+				// The source pixels are only needed when the environment has to be rendered again
+				state->succeeded = state->environmentReused || state->environmentCached
+					|| (!state->cancelled && IblBaker::decodeEquirectangular(imageFile, state->image));
+
+				// Only containers are read in place
+				imageFile.close();
+			}
+		}
+
+		state->done = true;
+	});
+}
+
+EnvironmentBake::~EnvironmentBake()
+{
+	mDecodeState->cancelled = true;
+
+	// Compressions and cache stores still running are finished, their results are worth keeping
+	for (std::thread& worker : mWorkers) {
+		worker.join();
+	}
+
+	glDeleteQueries(TIMER_QUERIES, mTimerQueries);
+}
+
+bool EnvironmentBake::update(double budgetMs)
+{
+	if (mDone) {
+		return true;
+	}
+
+	if (!mScheduled) {
+		if (!mDecodeState->done) {
+			return false;
+		}
+
+		if (!mDecodeState->succeeded) {
+			std::cout << "Failed to load HDR image." << std::endl;
+
+			// Empty maps, like a texture that failed to load
+			mEnvironmentMap = std::make_shared<CubeMap>();
+			mIrradianceSH = std::make_shared<SphericalHarmonics>();
+			mPreFilterMap = std::make_shared<CubeMap>();
+			mDone = true;
+			return true;
+		}
+
+		mSettings = mDecodeState->settings;
+		schedule();
+	}
+
+	readTimerQueries();
+
+	// Queries still in flight are left alone, these slices then go untimed
+	GLuint query = mTimerQueries[mTimerQuery];
+	bool timed = mTimedSlices[mTimerQuery] == 0;
+
+	if (timed) {
+		glBeginQuery(GL_TIME_ELAPSED, query);
+	}
+
+	// At least one slice per update so the bake always moves forward, only one until the GPU
+	// time of a slice is known
+	auto start = std::chrono::steady_clock::now();
+	size_t slices = 0;
+
+	while (!mSlices.empty()) {
+		// A slice waiting on a worker stays in front until the next update
+		if (!mSlices.front()()) {
+			break;
+		}
+
+		mSlices.pop_front();
+		++slices;
+
+		// The CPU time of the submissions plus the estimated GPU time of the slices
+		double spentMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+			+ static_cast<double>(slices) * mSliceGpuMs;
+
+		if (mSliceGpuMs < 0.0 || spentMs >= budgetMs) {
+			break;
+		}
+	}
+
+	if (timed) {
+		glEndQuery(GL_TIME_ELAPSED);
+
+		if (slices > 0) {
+			mTimedSlices[mTimerQuery] = slices;
+			mTimerQuery = (mTimerQuery + 1) % TIMER_QUERIES;
+		}
+	}
+
+	if (mSlices.empty()) {
+		mDone = true;
+		mSucceeded = true;
+	}
+
+	return mDone;
+}
+
+void EnvironmentBake::finish()
+{
+	while (!update(1000.0)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+bool EnvironmentBake::succeeded() const
+{
+	return mSucceeded;
+}
+
+float EnvironmentBake::getProgress() const
+{
+	if (mDone) {
+		return 1.0f;
+	}
+
+	if (!mScheduled || mSliceCount == 0) {
+		return 0.0f;
+	}
+
+	return static_cast<float>(mSliceCount - mSlices.size()) / static_cast<float>(mSliceCount);
+}
+
+const std::string& EnvironmentBake::getImagePath() const
+{
+	return mImagePath;
+}
+
+const IblQuality::Settings& EnvironmentBake::getSettings() const
+{
+	return mSettings;
+}
+
+std::shared_ptr<CubeMap> EnvironmentBake::getEnvironmentMap() const
+{
+	return mEnvironmentMap;
+}
+
+std::shared_ptr<SphericalHarmonics> EnvironmentBake::getIrradianceSH() const
+{
+	return mIrradianceSH;
+}
+
+std::shared_ptr<CubeMap> EnvironmentBake::getPreFilterMap() const
+{
+	return mPreFilterMap;
+}
+
+void EnvironmentBake::schedule()
+{
+	if (!mDecodeState->environmentReused) {
+		mEnvironmentMap = mDecodeState->environmentCached
+			? mGenerator.createCubeMap(mSettings.environmentFormat, mSettings.environmentResolution, mSettings.environmentMipLevels)
+			: mGenerator.createEnvironmentMap(mSettings);
+		mEnvironmentMap->setCacheKey(mDecodeState->environmentKey);
+		mIrradianceSH = std::make_shared<SphericalHarmonics>();
+	}
+
+	if (!mDecodeState->preFilterReused) {
+		mPreFilterMap = mDecodeState->preFilterCached
+			? mGenerator.createCubeMap(mSettings.preFilterFormat, mSettings.preFilterResolution, mSettings.preFilterMipLevels)
+			: mGenerator.createPreFilterMap(mSettings);
+		mPreFilterMap->setCacheKey(mDecodeState->preFilterKey);
+	}
+	else {
+		mReusedPreFilterLevels = glm::ivec2(mPreFilterMap->getFirstBakedLevel(), std::min(mPreFilterMap->getLastBakedLevel(), mSettings.preFilterMipLevels - 1));
+	}
+
+	// Cached maps come complete, a reused one keeps the mips it holds
+	glm::ivec2 neededLevels = IblQuality::preFilterLevels(mSettings, mRoughnessRange);
+
+	if (mDecodeState->preFilterCached) {
+		mPreFilterLevels = glm::ivec2(0, mSettings.preFilterMipLevels - 1);
+	}
+	else if (mDecodeState->preFilterReused) {
+		mPreFilterLevels = glm::ivec2(std::min(neededLevels.x, mReusedPreFilterLevels.x), std::max(neededLevels.y, mReusedPreFilterLevels.y));
+	}
+	else {
+		mPreFilterLevels = neededLevels;
+	}
+
+	scheduleEnvironment();
+	scheduleIrradiance();
+	schedulePreFilter();
+	schedulePacking();
+	scheduleCacheStore();
+
+	mSliceCount = mSlices.size();
+	mScheduled = true;
+}
+
+bool EnvironmentBake::rendersPreFilter() const
+{
+	return !mDecodeState->preFilterCached && mPreFilterLevels != mReusedPreFilterLevels;
+}
+
+bool EnvironmentBake::completesPreFilter() const
+{
+	return mPreFilterLevels == glm::ivec2(0, mSettings.preFilterMipLevels - 1);
+}
+
+void EnvironmentBake::scheduleEnvironment()
+{
+	std::shared_ptr<DecodeState> state = mDecodeState;
+
+	if (state->environmentReused) {
+		return;
+	}
+
+	if (state->environmentCached) {
+		for (int mip = 0; mip < mSettings.environmentMipLevels; ++mip) {
+			for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+				addSlice([this, state, mip, face]() {
+					BakeCache::uploadLevel(state->environmentLevels, GL_TEXTURE_CUBE_MAP, mEnvironmentMap->getId(), mip, face);
+				});
+			}
+		}
+
+		addSlice([state]() {
+			state->environmentLevels = BakeCache::Levels();
+			state->environmentFile.close();
+		});
+		return;
+	}
+
+	addSlice([this, state]() {
+		mGenerator.uploadEquirectangular(state->image);
+		state->image.pixels.clear();
+	});
+
+	for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+		addSlice([this, face]() {
+			mGenerator.renderEnvironmentFace(mSettings, *mEnvironmentMap, face);
+		});
+	}
+
+	addSlice([this]() {
+		mGenerator.finishEnvironmentMap(*mEnvironmentMap);
+	});
+}
+
+void EnvironmentBake::scheduleIrradiance()
+{
+	std::shared_ptr<DecodeState> state = mDecodeState;
+
+	if (state->environmentReused) {
+		return;
+	}
+
+	addSlice([this, state]() {
+		if (state->shCached) {
+			SHProjection::Coefficients coefficients;
+			memcpy(coefficients.data(), state->shData.data(), sizeof(coefficients));
+			mIrradianceSH->setCoefficients(coefficients);
+		}
+		else {
+			mIrradianceSH = mGenerator.generateIrradianceSH(mSettings, mEnvironmentMap);
+		}
+	});
+}
+
+void EnvironmentBake::schedulePreFilter()
+{
+	std::shared_ptr<DecodeState> state = mDecodeState;
+
+	if (state->preFilterCached) {
+		for (int mip = 0; mip < mSettings.preFilterMipLevels; ++mip) {
+			for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+				addSlice([this, state, mip, face]() {
+					BakeCache::uploadLevel(state->preFilterLevels, GL_TEXTURE_CUBE_MAP, mPreFilterMap->getId(), mip, face);
+				});
+			}
+		}
+
+		addSlice([state]() {
+			state->preFilterLevels = BakeCache::Levels();
+			state->preFilterFile.close();
+		});
+		return;
+	}
+
+	if (!rendersPreFilter()) {
+		return;
+	}
+
+	for (int mip = mPreFilterLevels.x; mip <= mPreFilterLevels.y; ++mip) {
+		if (mip >= mReusedPreFilterLevels.x && mip <= mReusedPreFilterLevels.y) {
+			continue;
+		}
+
+		for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+			addSlice([this, mip, face]() {
+				mGenerator.renderPreFilterFace(mSettings, mEnvironmentMap, *mPreFilterMap, mip, face);
+			});
+		}
+	}
+
+	addSlice([this]() {
+		mPreFilterMap->setBakedLevels(mPreFilterLevels.x, mPreFilterLevels.y);
+	});
+}
+
+void EnvironmentBake::schedulePacking()
+{
+	std::shared_ptr<DecodeState> state = mDecodeState;
+
+	// Packed after the prefilter pass, which samples the environment at full precision
+	if (!state->environmentReused && !state->environmentCached) {
+		scheduleConversion(mEnvironmentMap, mEnvironmentTarget, mSettings.environmentFormat, mSettings.environmentResolution, mSettings.environmentMipLevels);
+	}
+
+	if (rendersPreFilter() && completesPreFilter()) {
+		scheduleConversion(mPreFilterMap, mPreFilterTarget, mSettings.preFilterFormat, mSettings.preFilterResolution, mSettings.preFilterMipLevels);
+	}
+}
+
+void EnvironmentBake::scheduleConversion(std::shared_ptr<CubeMap>& map, std::shared_ptr<CubeMap>& target, GLenum format, int resolution, int mipLevels)
+{
+	if (IblQuality::renderFormat(format) == format) {
+		return;
+	}
+
+	addSlice([this, &map, &target, format, resolution, mipLevels]() {
+		target = mGenerator.createCubeMap(format, resolution, mipLevels);
+		target->setCacheKey(map->getCacheKey());
+	});
+
+	if (IblQuality::isCompressed(format)) {
+		// The render format levels are read back and compressed by a worker while frames go on
+		struct Compression
+		{
+			std::atomic<bool> done{ false };
+			BakeCache::Levels source;
+			BakeCache::Levels levels;
+		};
+
+		std::shared_ptr<Compression> compression = std::make_shared<Compression>();
+
+		addSlice([&map, compression, mipLevels]() {
+			BakeCache::allocateLevels(GL_TEXTURE_CUBE_MAP, map->getId(), ENVIRONMENT_FACES, mipLevels, compression->source);
+		});
+
+		for (int mip = 0; mip < mipLevels; ++mip) {
+			for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+				addSlice([&map, compression, mip, face]() {
+					BakeCache::downloadLevel(compression->source, GL_TEXTURE_CUBE_MAP, map->getId(), mip, face);
+				});
+			}
+		}
+
+		addSlice([this, compression, format]() {
+			startWorker([compression, format]() {
+				IblBaker::compressLevels(compression->source, format, compression->levels);
+				compression->source.data.clear();
+				compression->done = true;
+			});
+		});
+
+		addWait([compression]() {
+			return compression->done.load();
+		});
+
+		for (int mip = 0; mip < mipLevels; ++mip) {
+			for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+				addSlice([&target, compression, mip, face]() {
+					BakeCache::uploadLevel(compression->levels, GL_TEXTURE_CUBE_MAP, target->getId(), mip, face);
+				});
+			}
+		}
+	}
+	else {
+		for (int mip = 0; mip < mipLevels; ++mip) {
+			for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+				addSlice([this, &map, &target, format, resolution, mip, face]() {
+					mGenerator.packLevel(*map, *target, format, resolution, mip, face);
+				});
+			}
+		}
+	}
+
+	addSlice([&map, &target]() {
+		map = std::move(target);
+	});
+}
+
+void EnvironmentBake::addSlice(std::function<void()> slice)
+{
+	mSlices.push_back([slice]() {
+		slice();
+		return true;
+	});
+}
+
+void EnvironmentBake::addWait(std::function<bool()> ready)
+{
+	mSlices.push_back(ready);
+}
+
+void EnvironmentBake::startWorker(std::function<void()> work)
+{
+	mWorkers.emplace_back(std::move(work));
+}
+
+void EnvironmentBake::readTimerQueries()
+{
+	for (int i = 0; i < TIMER_QUERIES; ++i) {
+		if (mTimedSlices[i] == 0) {
+			continue;
+		}
+
+		GLint available = 0;
+		glGetQueryObjectiv(mTimerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (!available) {
+			continue;
+		}
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(mTimerQueries[i], GL_QUERY_RESULT, &elapsed);
+		double sliceMs = static_cast<double>(elapsed) / 1.0e6 / static_cast<double>(mTimedSlices[i]);
+
+		// Slices differ a lot in cost, the average follows the recent ones
+		mSliceGpuMs = mSliceGpuMs < 0.0 ? sliceMs : 0.5 * (mSliceGpuMs + sliceMs);
+		mTimedSlices[i] = 0;
+	}
+}
+
+void EnvironmentBake::scheduleCacheStore()
+{
+	std::shared_ptr<DecodeState> state = mDecodeState;
+	bool storeEnvironment = !state->environmentReused && !state->environmentCached;
+	bool storeSH = !state->environmentReused && !state->shCached;
+	bool storePreFilter = rendersPreFilter() && completesPreFilter();
+
+	if (!storeEnvironment && !storeSH && !storePreFilter) {
+		return;
+	}
+
+	// Read back level by level, the file writes happen off the render thread
+	struct Readback
+	{
+		BakeCache::Levels environmentLevels;
+		BakeCache::Levels preFilterLevels;
+		SHProjection::Coefficients coefficients;
+	};
+
+	std::shared_ptr<Readback> readback = std::make_shared<Readback>();
+
+	if (storeEnvironment) {
+		addSlice([this, readback]() {
+			BakeCache::allocateLevels(GL_TEXTURE_CUBE_MAP, mEnvironmentMap->getId(), ENVIRONMENT_FACES, mSettings.environmentMipLevels, readback->environmentLevels);
+		});
+
+		for (int mip = 0; mip < mSettings.environmentMipLevels; ++mip) {
+			for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+				addSlice([this, readback, mip, face]() {
+					if (!readback->environmentLevels.data.empty()) {
+						BakeCache::downloadLevel(readback->environmentLevels, GL_TEXTURE_CUBE_MAP, mEnvironmentMap->getId(), mip, face);
+					}
+				});
+			}
+		}
+	}
+
+	if (storePreFilter) {
+		addSlice([this, readback]() {
+			BakeCache::allocateLevels(GL_TEXTURE_CUBE_MAP, mPreFilterMap->getId(), ENVIRONMENT_FACES, mSettings.preFilterMipLevels, readback->preFilterLevels);
+		});
+
+		for (int mip = 0; mip < mSettings.preFilterMipLevels; ++mip) {
+			for (int face = 0; face < ENVIRONMENT_FACES; ++face) {
+				addSlice([this, readback, mip, face]() {
+					if (!readback->preFilterLevels.data.empty()) {
+						BakeCache::downloadLevel(readback->preFilterLevels, GL_TEXTURE_CUBE_MAP, mPreFilterMap->getId(), mip, face);
+					}
+				});
+			}
+		}
+	}
+
+	addSlice([this, state, readback, storeSH]() {
+		readback->coefficients = mIrradianceSH->getCoefficients();
+		BakeCache bakeCache = mGenerator.getBakeCache();
+
+		startWorker([state, readback, bakeCache, storeSH]() {
+			if (!readback->environmentLevels.data.empty()) {
+				bakeCache.writeLevels(state->environmentKey + ".env", readback->environmentLevels);
+			}
+
+			if (!readback->preFilterLevels.data.empty()) {
+				bakeCache.writeLevels(state->preFilterKey + ".prefilter", readback->preFilterLevels);
+			}
+
+			if (storeSH) {
+				bakeCache.storeData(state->environmentKey + ".sh", readback->coefficients.data(), sizeof(SHProjection::Coefficients));
+			}
+
+			bakeCache.evict();
+		});
+	});
+}
@@ -0,0 +1,59 @@
+#include "files.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+	std::atomic<uint64_t> temporaryCounter{ 0 };
+}
+
+bool Files::hasExtension(const std::string& path, const char* extension)
+{
+	size_t length = strlen(extension);
+
+	if (path.size() < length) {
+		return false;
+	}
+
+	return std::equal(path.end() - length, path.end(), extension, [](unsigned char a, unsigned char b) {
+		return std::tolower(a) == std::tolower(b);
+	});
+}
+
+bool Files::writeAtomic(const std::string& path, const std::function<bool(std::ofstream& file)>& write)
+{
+	std::string temporaryPath = path + "." + std::to_string(temporaryCounter++) + TEMPORARY_EXTENSION;
+	std::error_code error;
+
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+
+		if (!write(file) || !file.good()) {
+			file.close();
+			fs::remove(temporaryPath, error);
+			return false;
+		}
+	}
+
+	fs::rename(temporaryPath, path, error);
+
+	if (error) {
+		fs::remove(temporaryPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool Files::writeAtomic(const std::string& path, const void* data, size_t size)
+{
+	return writeAtomic(path, [data, size](std::ofstream& file) {
+		file.write(static_cast<const char*>(data), size);
+		return true;
+	});
+}
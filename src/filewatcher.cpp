@@ -0,0 +1,254 @@
+#include "filewatcher.h"
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+	// Quiet time after the last notification of a directory before its files are compared
+	const int SETTLE_MS = 50;
+}
+
+FileWatcher::FileWatcher()
+{
+#ifdef _WIN32
+	mWakeEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+#else
+	mWakeFile = eventfd(0, EFD_CLOEXEC);
+#endif
+
+	mThread = std::thread(&FileWatcher::watchLoop, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+
+	wake();
+	mThread.join();
+
+#ifdef _WIN32
+	CloseHandle(mWakeEvent);
+#else
+	close(mWakeFile);
+#endif
+}
+
+void FileWatcher::setPaths(const std::vector<std::string>& paths)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	bool unchanged = paths.size() == mFiles.size() && std::all_of(paths.begin(), paths.end(),
+		[this](const std::string& path) { return mFiles.find(path) != mFiles.end(); });
+
+	if (unchanged) {
+		return;
+	}
+
+	std::map<std::string, Version> files;
+
+	for (const std::string& path : paths) {
+		auto it = mFiles.find(path);
+		files[path] = it != mFiles.end() ? it->second : Version();
+	}
+
+	// New files are compared with their current version, only later changes are reported
+	for (auto& file : files) {
+		if (mFiles.find(file.first) == mFiles.end()) {
+			file.second = version(file.first);
+		}
+	}
+
+	mFiles.swap(files);
+	mPathsChanged = true;
+	wake();
+}
+
+std::vector<std::string> FileWatcher::takeChanged()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::vector<std::string> changed;
+	changed.swap(mChanged);
+
+	return changed;
+}
+
+FileWatcher::Version FileWatcher::version(const std::string& path)
+{
+	std::error_code error;
+	Version version;
+	fs::file_time_type modificationTime = fs::last_write_time(path, error);
+
+	if (!error) {
+		version.modificationTime = modificationTime.time_since_epoch().count();
+		version.size = fs::file_size(path, error);
+	}
+
+	// Missing files keep a zero time and size
+	return error ? Version() : version;
+}
+
+std::vector<std::string> FileWatcher::directories()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::vector<std::string> directories;
+
+	for (const auto& file : mFiles) {
+		std::string directory = fs::path(file.first).parent_path().string();
+		directory = directory.empty() ? "." : directory;
+
+		if (std::find(directories.begin(), directories.end(), directory) == directories.end()) {
+			directories.push_back(directory);
+		}
+	}
+
+	mPathsChanged = false;
+	return directories;
+}
+
+void FileWatcher::scan()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	for (auto& file : mFiles) {
+		Version current = version(file.first);
+
+		if (current.modificationTime == file.second.modificationTime && current.size == file.second.size) {
+			continue;
+		}
+
+		file.second = current;
+
+		// Deleted files are reported when they come back
+		bool exists = current.modificationTime != 0 || current.size != 0;
+
+		if (exists && std::find(mChanged.begin(), mChanged.end(), file.first) == mChanged.end()) {
+			mChanged.push_back(file.first);
+		}
+	}
+}
+
+void FileWatcher::wake()
+{
+#ifdef _WIN32
+	SetEvent(mWakeEvent);
+#else
+	uint64_t value = 1;
+	ssize_t written = write(mWakeFile, &value, sizeof(value));
+	(void)written;
+#endif
+}
+
+void FileWatcher::watchLoop()
+{
+#ifdef _WIN32
+	for (;;) {
+		std::vector<HANDLE> handles = { mWakeEvent };
+
+		for (const std::string& directory : directories()) {
+			if (handles.size() == MAXIMUM_WAIT_OBJECTS) {
+				break;
+			}
+
+			HANDLE handle = FindFirstChangeNotificationA(directory.c_str(), FALSE,
+				FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+
+			if (handle != INVALID_HANDLE_VALUE) {
+				handles.push_back(handle);
+			}
+		}
+
+		// Until the watched files change or the watcher stops
+		for (;;) {
+			DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE);
+
+			// Only WAIT_OBJECT_0 + 1 to WAIT_OBJECT_0 + n - 1 are directory notifications, the wake
+			// event, abandoned waits and failures end the wait
+			if (result == WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + handles.size()) {
+				break;
+			}
+
+			HANDLE changed = handles[result - WAIT_OBJECT_0];
+
+			do {
+				FindNextChangeNotification(changed);
+			} while (WaitForSingleObject(changed, SETTLE_MS) == WAIT_OBJECT_0);
+
+			scan();
+		}
+
+		for (size_t i = 1; i < handles.size(); ++i) {
+			FindCloseChangeNotification(handles[i]);
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (mStopping) {
+			return;
+		}
+	}
+#else
+	int notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	for (;;) {
+		std::vector<int> watches;
+
+		for (const std::string& directory : directories()) {
+			int watch = notify < 0 ? -1 : inotify_add_watch(notify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MODIFY);
+
+			if (watch >= 0) {
+				watches.push_back(watch);
+			}
+		}
+
+		// Until the watched files change or the watcher stops
+		for (;;) {
+			pollfd files[2] = { { mWakeFile, POLLIN, 0 }, { notify, POLLIN, 0 } };
+
+			if (poll(files, 2, -1) < 0 || files[0].revents) {
+				break;
+			}
+
+			char events[4096];
+
+			do {
+				while (read(notify, events, sizeof(events)) > 0) {
+				}
+			} while (poll(&files[1], 1, SETTLE_MS) > 0);
+
+			scan();
+		}
+
+		uint64_t value;
+		ssize_t wakes = read(mWakeFile, &value, sizeof(value));
+		(void)wakes;
+
+		for (int watch : watches) {
+			inotify_rm_watch(notify, watch);
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (mStopping) {
+			if (notify >= 0) {
+				close(notify);
+			}
+
+			return;
+		}
+	}
+#endif
+}
@@ -0,0 +1,27 @@
+#include "halffloat.h"
+#include "simd.h"
+
+namespace {
+	const float HALF_MAX = 65504.0f;
+}
+
+void HalfFloat::fromFloats(const float* values, uint16_t* halves, size_t count)
+{
+	size_t i = 0;
+
+#ifdef PBR_F16C
+	const __m256 maxValue = _mm256_set1_ps(HALF_MAX);
+	const __m256 minValue = _mm256_set1_ps(-HALF_MAX);
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 value = _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(values + i), maxValue), minValue);
+		_mm_storeu_si128((__m128i*)(halves + i), _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+	}
+#endif
+
+	// Same operand order as the vector min/max, NaN saturates too
+	for (; i < count; ++i) {
+		float value = values[i] < HALF_MAX ? values[i] : HALF_MAX;
+		halves[i] = fromFloat(value > -HALF_MAX ? value : -HALF_MAX);
+	}
+}
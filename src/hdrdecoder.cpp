@@ -0,0 +1,270 @@
+#include "hdrdecoder.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "halffloat.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace {
+	const int MIN_RLE_WIDTH = 8;
+	const int MAX_RLE_WIDTH = 0x7FFF;
+
+	bool readLine(const char* data, size_t size, size_t& offset, std::string& line)
+	{
+		const char* begin = data + offset;
+		const char* end = static_cast<const char*>(memchr(begin, '\n', size - offset));
+
+		if (!end) {
+			return false;
+		}
+
+		line.assign(begin, end);
+
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+
+		offset = static_cast<size_t>(end - data) + 1;
+		return true;
+	}
+
+	bool isRleScanline(const unsigned char* scanline, size_t available, int width)
+	{
+		return width >= MIN_RLE_WIDTH && width <= MAX_RLE_WIDTH && available >= 4
+			&& scanline[0] == 2 && scanline[1] == 2 && (scanline[2] & 0x80) == 0
+			&& ((scanline[2] << 8) | scanline[3]) == width;
+	}
+
+	// Walks the run headers without decoding anything, returns the scanline's size or 0 when corrupt
+	size_t scanlineSize(const unsigned char* scanline, size_t available, int width)
+	{
+		if (!isRleScanline(scanline, available, width)) {
+			size_t flatSize = static_cast<size_t>(width) * 4;
+			return flatSize <= available ? flatSize : 0;
+		}
+
+		size_t offset = 4;
+
+		for (int channel = 0; channel < 4; ++channel) {
+			int count = 0;
+
+			while (count < width) {
+				if (offset >= available) {
+					return 0;
+				}
+
+				int run = scanline[offset++];
+
+				if (run > 128) {
+					run -= 128;
+					offset += 1;
+				}
+				else {
+					offset += run;
+				}
+
+				if (run == 0 || count + run > width) {
+					return 0;
+				}
+
+				count += run;
+			}
+		}
+
+		return offset <= available ? offset : 0;
+	}
+
+	// Planar R, G, B and E channels of a scanline
+	void decodeScanline(const unsigned char* scanline, int width, unsigned char* planes)
+	{
+		if (!isRleScanline(scanline, 4, width)) {
+			for (int x = 0; x < width; ++x) {
+				for (int channel = 0; channel < 4; ++channel) {
+					planes[channel * width + x] = scanline[x * 4 + channel];
+				}
+			}
+
+			return;
+		}
+
+		const unsigned char* input = scanline + 4;
+
+		for (int channel = 0; channel < 4; ++channel) {
+			unsigned char* output = planes + channel * width;
+			int count = 0;
+
+			while (count < width) {
+				int run = *input++;
+
+				if (run > 128) {
+					run -= 128;
+					memset(output + count, *input++, run);
+				}
+				else {
+					memcpy(output + count, input, run);
+					input += run;
+				}
+
+				count += run;
+			}
+		}
+	}
+
+	void convertScalar(const unsigned char* planes, int width, int begin, float* rgb)
+	{
+		const unsigned char* r = planes;
+		const unsigned char* g = planes + width;
+		const unsigned char* b = planes + width * 2;
+		const unsigned char* e = planes + width * 3;
+
+		for (int x = begin; x < width; ++x) {
+			float scale = e[x] ? std::ldexp(1.0f, e[x] - (128 + 8)) : 0.0f;
+			rgb[x * 3 + 0] = r[x] * scale;
+			rgb[x * 3 + 1] = g[x] * scale;
+			rgb[x * 3 + 2] = b[x] * scale;
+		}
+	}
+
+#ifdef PBR_SSE2
+	// 2^(e - 128 - 8) built directly in the exponent bits, zero for e == 0. e == 1 flushes to zero
+	// as well, a difference of less than 2^-119.
+	inline __m128 rgbeScale(__m128i exponent)
+	{
+		__m128i bits = _mm_slli_epi32(_mm_sub_epi32(exponent, _mm_set1_epi32(1)), 23);
+		__m128 scale = _mm_mul_ps(_mm_castsi128_ps(bits), _mm_set1_ps(1.0f / 256.0f));
+		return _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(exponent, _mm_setzero_si128())), scale);
+	}
+
+	inline __m128i widenBytes(const unsigned char* bytes)
+	{
+		int32_t packed;
+		memcpy(&packed, bytes, sizeof(packed));
+		__m128i zero = _mm_setzero_si128();
+		return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+	}
+
+	// Interleaves 4 pixels. Each store writes a 4th float which the next one overwrites, so the
+	// caller must leave at least one pixel for the scalar tail.
+	inline void storeRGB(__m128 r, __m128 g, __m128 b, float* rgb)
+	{
+		__m128 a = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+		_mm_storeu_ps(rgb + 0, r);
+		_mm_storeu_ps(rgb + 3, g);
+		_mm_storeu_ps(rgb + 6, b);
+		_mm_storeu_ps(rgb + 9, a);
+	}
+#endif
+
+	void convertScanline(const unsigned char* planes, int width, float* rgb)
+	{
+		int x = 0;
+
+#ifdef PBR_AVX2
+		for (; x + 8 < width; x += 8) {
+			__m256i exponent = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(planes + width * 3 + x)));
+			__m256i bits = _mm256_slli_epi32(_mm256_sub_epi32(exponent, _mm256_set1_epi32(1)), 23);
+			__m256 scale = _mm256_mul_ps(_mm256_castsi256_ps(bits), _mm256_set1_ps(1.0f / 256.0f));
+			scale = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(exponent, _mm256_setzero_si256())), scale);
+
+			__m256 r = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(planes + x)))), scale);
+			__m256 g = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(planes + width + x)))), scale);
+			__m256 b = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(planes + width * 2 + x)))), scale);
+
+			storeRGB(_mm256_castps256_ps128(r), _mm256_castps256_ps128(g), _mm256_castps256_ps128(b), rgb + x * 3);
+			storeRGB(_mm256_extractf128_ps(r, 1), _mm256_extractf128_ps(g, 1), _mm256_extractf128_ps(b, 1), rgb + x * 3 + 12);
+		}
+#endif
+
+#ifdef PBR_SSE2
+		for (; x + 4 < width; x += 4) {
+			__m128 scale = rgbeScale(widenBytes(planes + width * 3 + x));
+			__m128 r = _mm_mul_ps(_mm_cvtepi32_ps(widenBytes(planes + x)), scale);
+			__m128 g = _mm_mul_ps(_mm_cvtepi32_ps(widenBytes(planes + width + x)), scale);
+			__m128 b = _mm_mul_ps(_mm_cvtepi32_ps(widenBytes(planes + width * 2 + x)), scale);
+			storeRGB(r, g, b, rgb + x * 3);
+		}
+#endif
+
+		convertScalar(planes, width, x, rgb);
+	}
+}
+
+bool HdrDecoder::readHeader(const char* data, size_t size, Header& header)
+{
+	size_t offset = 0;
+	std::string line;
+
+	if (!readLine(data, size, offset, line) || (line != "#?RADIANCE" && line != "#?RGBE")) {
+		return false;
+	}
+
+	// Variables up to an empty line
+	while (true) {
+		if (!readLine(data, size, offset, line)) {
+			return false;
+		}
+
+		if (line.empty()) {
+			break;
+		}
+
+		if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+			return false;
+		}
+	}
+
+	if (!readLine(data, size, offset, line)) {
+		return false;
+	}
+
+	int width, height;
+	char trailing;
+
+	if (sscanf(line.c_str(), "-Y %d +X %d%c", &height, &width, &trailing) != 2 || width <= 0 || height <= 0) {
+		return false;
+	}
+
+	header.width = width;
+	header.height = height;
+	header.dataOffset = offset;
+	return true;
+}
+
+bool HdrDecoder::decode(const char* data, size_t size, const Header& header, uint16_t* rgb)
+{
+	const unsigned char* pixels = reinterpret_cast<const unsigned char*>(data);
+	std::vector<size_t> offsets(header.height);
+	size_t offset = header.dataOffset;
+
+	// Scanlines are variable length, finding where each one starts is the only serial part
+	for (int y = 0; y < header.height; ++y) {
+		size_t scanline = scanlineSize(pixels + offset, size - offset, header.width);
+
+		if (scanline == 0) {
+			return false;
+		}
+
+		offsets[y] = offset;
+		offset += scanline;
+	}
+
+	size_t rowSize = static_cast<size_t>(header.width) * 3;
+
+	parallelFor(header.height, [&](size_t begin, size_t end) {
+		std::vector<unsigned char> planes(static_cast<size_t>(header.width) * 4);
+		std::vector<float> floats(rowSize);
+
+		for (size_t y = begin; y < end; ++y) {
+			decodeScanline(pixels + offsets[y], header.width, planes.data());
+			convertScanline(planes.data(), header.width, floats.data());
+			HalfFloat::fromFloats(floats.data(), rgb + rowSize * (header.height - 1 - y), rowSize);
+		}
+	});
+
+	return true;
+}
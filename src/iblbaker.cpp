@@ -0,0 +1,367 @@
+#include "iblbaker.h"
+#include <stb_image.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include "bc6h.h"
+#include "blockencoding.h"
+#include "halffloat.h"
+#include "hdrdecoder.h"
+#include "packedfloat.h"
+#include "parallel.h"
+#include "prefiltersamples.h"
+#include "sharedexponent.h"
+
+namespace {
+	const int FACES = 6;
+
+	// Cubemap face basis for GL face order: direction = major + u * uAxis + v * vAxis
+	const glm::vec3 faceMajor[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	const glm::vec3 faceU[6] = { { 0, 0, -1 }, { 0, 0, 1 }, { 1, 0, 0 }, { 1, 0, 0 }, { 1, 0, 0 }, { -1, 0, 0 } };
+	const glm::vec3 faceV[6] = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+
+	glm::vec3 texelDirection(int face, int x, int y, int resolution)
+	{
+		float u = 2.0f * (x + 0.5f) / resolution - 1.0f;
+		float v = 2.0f * (y + 0.5f) / resolution - 1.0f;
+		return glm::normalize(faceMajor[face] + u * faceU[face] + v * faceV[face]);
+	}
+
+	// Face and texture coordinates of a direction, following the GL cube map selection rules
+	int selectFace(const glm::vec3& dir, float& s, float& t)
+	{
+		glm::vec3 absDir = glm::abs(dir);
+		int face;
+		float sc, tc, ma;
+
+		if (absDir.x >= absDir.y && absDir.x >= absDir.z) {
+			face = dir.x > 0.0f ? 0 : 1;
+			ma = absDir.x;
+			sc = dir.x > 0.0f ? -dir.z : dir.z;
+			tc = -dir.y;
+		}
+		else if (absDir.y >= absDir.z) {
+			face = dir.y > 0.0f ? 2 : 3;
+			ma = absDir.y;
+			sc = dir.x;
+			tc = dir.y > 0.0f ? dir.z : -dir.z;
+		}
+		else {
+			face = dir.z > 0.0f ? 4 : 5;
+			ma = absDir.z;
+			sc = dir.z > 0.0f ? dir.x : -dir.x;
+			tc = -dir.y;
+		}
+
+		s = 0.5f * (sc / ma + 1.0f);
+		t = 0.5f * (tc / ma + 1.0f);
+		return face;
+	}
+
+	// GL_LINEAR lookup with GL_CLAMP_TO_EDGE, texels are read through a fetch(x, y, channel) functor
+	template <typename Fetch>
+	glm::vec3 bilinear(float s, float t, int width, int height, const Fetch& fetch)
+	{
+		float x = s * width - 0.5f;
+		float y = t * height - 0.5f;
+		float x0f = std::floor(x);
+		float y0f = std::floor(y);
+		float fx = x - x0f;
+		float fy = y - y0f;
+
+		int x0 = std::min(std::max(static_cast<int>(x0f), 0), width - 1);
+		int y0 = std::min(std::max(static_cast<int>(y0f), 0), height - 1);
+		int x1 = std::min(std::max(static_cast<int>(x0f) + 1, 0), width - 1);
+		int y1 = std::min(std::max(static_cast<int>(y0f) + 1, 0), height - 1);
+
+		glm::vec3 result;
+		for (int c = 0; c < 3; ++c) {
+			float top = fetch(x0, y0, c) * (1.0f - fx) + fetch(x1, y0, c) * fx;
+			float bottom = fetch(x0, y1, c) * (1.0f - fx) + fetch(x1, y1, c) * fx;
+			result[c] = top * (1.0f - fy) + bottom * fy;
+		}
+
+		return result;
+	}
+
+	glm::vec3 sampleLevel(const IblBaker::CubeMapLevels& cubeMap, const glm::vec3& dir, int mip)
+	{
+		float s, t;
+		int face = selectFace(dir, s, t);
+		int resolution = cubeMap.levelResolution(mip);
+		const float* texels = cubeMap.faceData(mip, face);
+
+		return bilinear(s, t, resolution, resolution, [&](int x, int y, int c) {
+			return texels[(static_cast<size_t>(y) * resolution + x) * 3 + c];
+		});
+	}
+
+	// GL_LINEAR_MIPMAP_LINEAR lookup at an explicit lod, like textureLod
+	glm::vec3 sampleLod(const IblBaker::CubeMapLevels& cubeMap, const glm::vec3& dir, float lod)
+	{
+		lod = std::min(std::max(lod, 0.0f), static_cast<float>(cubeMap.mipLevels() - 1));
+		int mip = static_cast<int>(lod);
+		float blend = lod - mip;
+		glm::vec3 color = sampleLevel(cubeMap, dir, mip);
+
+		if (blend > 0.0f) {
+			color = color * (1.0f - blend) + sampleLevel(cubeMap, dir, mip + 1) * blend;
+		}
+
+		return color;
+	}
+
+	IblBaker::CubeMapLevels allocateCubeMap(int resolution, int mipLevels)
+	{
+		IblBaker::CubeMapLevels cubeMap;
+		cubeMap.resolution = resolution;
+		cubeMap.levels.resize(mipLevels);
+
+		for (int mip = 0; mip < mipLevels; ++mip) {
+			size_t levelResolution = cubeMap.levelResolution(mip);
+			cubeMap.levels[mip].resize(FACES * levelResolution * levelResolution * 3);
+		}
+
+		return cubeMap;
+	}
+
+	// Runs texel(face, x, y, rgb) for every texel of a level, rows are spread over all threads
+	template <typename Texel>
+	void forEachTexel(IblBaker::CubeMapLevels& cubeMap, int mip, const Texel& texel)
+	{
+		int resolution = cubeMap.levelResolution(mip);
+
+		parallelFor(static_cast<size_t>(FACES) * resolution, [&](size_t begin, size_t end) {
+			for (size_t row = begin; row < end; ++row) {
+				int face = static_cast<int>(row / resolution);
+				int y = static_cast<int>(row % resolution);
+				float* rgb = cubeMap.faceData(mip, face) + static_cast<size_t>(y) * resolution * 3;
+
+				for (int x = 0; x < resolution; ++x, rgb += 3) {
+					texel(face, x, y, rgb);
+				}
+			}
+		});
+	}
+}
+
+int IblBaker::CubeMapLevels::mipLevels() const
+{
+	return static_cast<int>(levels.size());
+}
+
+int IblBaker::CubeMapLevels::levelResolution(int mip) const
+{
+	return std::max(1, resolution >> mip);
+}
+
+const float* IblBaker::CubeMapLevels::faceData(int mip, int face) const
+{
+	size_t levelResolution = this->levelResolution(mip);
+	return levels[mip].data() + face * levelResolution * levelResolution * 3;
+}
+
+float* IblBaker::CubeMapLevels::faceData(int mip, int face)
+{
+	return const_cast<float*>(static_cast<const CubeMapLevels*>(this)->faceData(mip, face));
+}
+
+bool IblBaker::decodeEquirectangular(const MappedFile& imageFile, EquirectangularImage& image)
+{
+	HdrDecoder::Header header;
+
+	if (HdrDecoder::readHeader(imageFile.data(), imageFile.size(), header)) {
+		image.width = header.width;
+		image.height = header.height;
+		image.pixels.resize(static_cast<size_t>(header.width) * header.height * 3);
+
+		if (HdrDecoder::decode(imageFile.data(), imageFile.size(), header, image.pixels.data())) {
+			return true;
+		}
+	}
+
+	// Other formats go through stb_image. The global stbi flip flag isn't touched, other threads may be decoding.
+	int nrComponents;
+	float *data = stbi_loadf_from_memory((const unsigned char*)imageFile.data(), static_cast<int>(imageFile.size()), &image.width, &image.height, &nrComponents, 3);
+
+	if (!data) {
+		return false;
+	}
+
+	size_t rowSize = static_cast<size_t>(image.width) * 3;
+	image.pixels.resize(rowSize * image.height);
+
+	for (int y = 0; y < image.height; ++y) {
+		HalfFloat::fromFloats(data + rowSize * (image.height - 1 - y), image.pixels.data() + rowSize * y, rowSize);
+	}
+
+	stbi_image_free(data);
+
+	return true;
+}
+
+void IblBaker::compressLevels(const TextureLevels& source, GLenum internalFormat, TextureLevels& target)
+{
+	target.setInternalFormat(internalFormat);
+
+	BlockEncoding::compressLevels(source, target, [](const char* pixels, int width, int height, int blockX, int blockY, uint8_t* block) {
+		BC6H::encodeBlock(reinterpret_cast<const uint16_t*>(pixels), width, height, blockX, blockY, block);
+	});
+}
+
+IblBaker::CubeMapLevels IblBaker::renderEnvironment(const EquirectangularImage& image, int resolution, int mipLevels)
+{
+	CubeMapLevels environment = allocateCubeMap(resolution, mipLevels);
+
+	// Same mapping as shaderequirectangular.fs
+	const glm::vec2 invAtan = glm::vec2(0.1591f, 0.3183f);
+
+	forEachTexel(environment, 0, [&](int face, int x, int y, float* rgb) {
+		glm::vec3 dir = texelDirection(face, x, y, resolution);
+		glm::vec2 uv = glm::vec2(std::atan2(dir.z, dir.x), std::asin(dir.y)) * invAtan + 0.5f;
+
+		glm::vec3 color = bilinear(uv.x, uv.y, image.width, image.height, [&](int px, int py, int c) {
+			return HalfFloat::toFloat(image.pixels[(static_cast<size_t>(py) * image.width + px) * 3 + c]);
+		});
+
+		rgb[0] = color.r;
+		rgb[1] = color.g;
+		rgb[2] = color.b;
+	});
+
+	// Box filtered mips like glGenerateMipmap
+	for (int mip = 1; mip < mipLevels; ++mip) {
+		int sourceResolution = environment.levelResolution(mip - 1);
+
+		forEachTexel(environment, mip, [&](int face, int x, int y, float* rgb) {
+			const float* source = environment.faceData(mip - 1, face);
+			int x0 = std::min(2 * x, sourceResolution - 1);
+			int x1 = std::min(2 * x + 1, sourceResolution - 1);
+			int y0 = std::min(2 * y, sourceResolution - 1);
+			int y1 = std::min(2 * y + 1, sourceResolution - 1);
+
+			for (int c = 0; c < 3; ++c) {
+				rgb[c] = 0.25f * (source[(y0 * sourceResolution + x0) * 3 + c] + source[(y0 * sourceResolution + x1) * 3 + c]
+					+ source[(y1 * sourceResolution + x0) * 3 + c] + source[(y1 * sourceResolution + x1) * 3 + c]);
+			}
+		});
+	}
+
+	return environment;
+}
+
+SHProjection::Coefficients IblBaker::projectIrradiance(const CubeMapLevels& environment)
+{
+	int mip = SHProjection::sourceMip(environment.resolution, environment.mipLevels());
+	int faceRes = environment.levelResolution(mip);
+	size_t texelCount = static_cast<size_t>(FACES) * faceRes * faceRes;
+
+	// The projection reads RGBA texels, as returned by glGetTexImage
+	std::vector<float> faces(4 * texelCount);
+	const float* rgb = environment.faceData(mip, 0);
+
+	for (size_t i = 0; i < texelCount; ++i) {
+		faces[i * 4] = rgb[i * 3];
+		faces[i * 4 + 1] = rgb[i * 3 + 1];
+		faces[i * 4 + 2] = rgb[i * 3 + 2];
+		faces[i * 4 + 3] = 1.0f;
+	}
+
+	return SHProjection::projectCubeMap(faces.data(), faceRes);
+}
+
+IblBaker::CubeMapLevels IblBaker::preFilter(const CubeMapLevels& environment, int resolution, int mipLevels)
+{
+	CubeMapLevels preFilterMap = allocateCubeMap(resolution, mipLevels);
+	std::vector<PrefilterSamples::Table> tables = PrefilterSamples::generateMips(mipLevels, environment.resolution, resolution);
+
+	for (int mip = 0; mip < mipLevels; ++mip) {
+		const PrefilterSamples::Table& table = tables[mip];
+		float invTotalWeight = 1.0f / table.totalWeight;
+
+		// Same integration as shaderprefilter.fs
+		forEachTexel(preFilterMap, mip, [&](int face, int x, int y, float* rgb) {
+			glm::vec3 N = texelDirection(face, x, y, preFilterMap.levelResolution(mip));
+			glm::vec3 up = std::abs(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+			glm::vec3 tangent = glm::normalize(glm::cross(up, N));
+			glm::vec3 bitangent = glm::cross(N, tangent);
+			glm::vec3 color(0.0f);
+
+			for (const glm::vec4& sample : table.samples) {
+				glm::vec3 L = tangent * sample.x + bitangent * sample.y + N * sample.z;
+				color += sampleLod(environment, L, sample.w) * sample.z;
+			}
+
+			color *= invTotalWeight;
+			rgb[0] = color.r;
+			rgb[1] = color.g;
+			rgb[2] = color.b;
+		});
+	}
+
+	return preFilterMap;
+}
+
+bool IblBaker::storeLevels(const CubeMapLevels& cubeMap, GLenum internalFormat, TextureLevels& levels)
+{
+	// Block compressed formats are encoded from the half float levels
+	GLenum levelsFormat = IblQuality::isCompressed(internalFormat) ? GL_RGB16F : internalFormat;
+
+	if (!levels.setInternalFormat(levelsFormat)) {
+		return false;
+	}
+
+	levels.width = cubeMap.resolution;
+	levels.height = cubeMap.resolution;
+	levels.faces = FACES;
+	levels.mipLevels = cubeMap.mipLevels();
+	levels.data.resize(levels.totalSize());
+
+	for (int mip = 0; mip < levels.mipLevels; ++mip) {
+		size_t texelCount = static_cast<size_t>(FACES) * cubeMap.levelResolution(mip) * cubeMap.levelResolution(mip);
+		const float* rgb = cubeMap.faceData(mip, 0);
+
+		if (levelsFormat == GL_RGB16F) {
+			HalfFloat::fromFloats(rgb, reinterpret_cast<uint16_t*>(levels.faceData(mip, 0)), texelCount * 3);
+		}
+		else if (levelsFormat == GL_R11F_G11F_B10F || levelsFormat == GL_RGB9_E5) {
+			uint32_t* texels = reinterpret_cast<uint32_t*>(levels.faceData(mip, 0));
+
+			for (size_t i = 0; i < texelCount; ++i) {
+				texels[i] = levelsFormat == GL_RGB9_E5
+					? SharedExponent::fromRGB(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2])
+					: PackedFloat::fromRGB(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+			}
+		}
+		else {
+			return false;
+		}
+	}
+
+	if (levelsFormat != internalFormat) {
+		TextureLevels compressed;
+		compressLevels(levels, internalFormat, compressed);
+		levels = std::move(compressed);
+	}
+
+	return true;
+}
+
+bool IblBaker::bake(const MappedFile& imageFile, const IblQuality::Settings& settings, IblContainer::Contents& contents)
+{
+	EquirectangularImage image;
+
+	if (!decodeEquirectangular(imageFile, image)) {
+		return false;
+	}
+
+	// The prefilter pass samples the environment at full precision, like on the GPU
+	CubeMapLevels environment = renderEnvironment(image, settings.environmentResolution, settings.environmentMipLevels);
+	image.pixels.clear();
+
+	contents.irradianceSH = projectIrradiance(environment);
+	CubeMapLevels preFilterMap = preFilter(environment, settings.preFilterResolution, settings.preFilterMipLevels);
+
+	return storeLevels(environment, settings.environmentFormat, contents.environment)
+		&& storeLevels(preFilterMap, settings.preFilterFormat, contents.preFilter);
+}
@@ -0,0 +1,96 @@
+#include "iblcontainer.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "files.h"
+
+namespace {
+	const char CONTAINER_MAGIC[4] = { 'P', 'B', 'R', 'I' };
+	const uint32_t CONTAINER_VERSION = 1;
+
+	struct ContainerHeader
+	{
+		char magic[4];
+		uint32_t version;
+		float irradianceSH[9][3];
+	};
+
+	bool validCubeMap(const TextureLevels& levels)
+	{
+		TextureLevels layout;
+		return levels.faces == 6 && levels.width == levels.height && levels.mipLevels > 0
+			&& layout.setInternalFormat(levels.internalFormat) && layout.format == levels.format && layout.type == levels.type
+			&& layout.bytesPerPixel == levels.bytesPerPixel;
+	}
+}
+
+bool IblContainer::isContainer(const std::string& path)
+{
+	return Files::hasExtension(path, EXTENSION);
+}
+
+bool IblContainer::read(const char* data, size_t size, Contents& contents)
+{
+	if (size < sizeof(ContainerHeader)) {
+		return false;
+	}
+
+	ContainerHeader header;
+	memcpy(&header, data, sizeof(ContainerHeader));
+
+	if (memcmp(header.magic, CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC)) != 0 || header.version != CONTAINER_VERSION) {
+		return false;
+	}
+
+	for (int i = 0; i < 9; ++i) {
+		contents.irradianceSH[i] = glm::vec3(header.irradianceSH[i][0], header.irradianceSH[i][1], header.irradianceSH[i][2]);
+	}
+
+	size_t offset = sizeof(ContainerHeader);
+	size_t blobSize;
+
+	if (!contents.environment.map(data + offset, size - offset, blobSize)) {
+		return false;
+	}
+
+	offset += blobSize;
+
+	if (!contents.preFilter.map(data + offset, size - offset, blobSize) || offset + blobSize != size) {
+		return false;
+	}
+
+	return validCubeMap(contents.environment) && validCubeMap(contents.preFilter);
+}
+
+bool IblContainer::write(const std::string& path, const Contents& contents)
+{
+	ContainerHeader header;
+	memcpy(header.magic, CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC));
+	header.version = CONTAINER_VERSION;
+
+	for (int i = 0; i < 9; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			header.irradianceSH[i][c] = contents.irradianceSH[i][c];
+		}
+	}
+
+	std::vector<char> data(sizeof(ContainerHeader));
+	memcpy(data.data(), &header, sizeof(ContainerHeader));
+	contents.environment.serialize(data);
+	contents.preFilter.serialize(data);
+
+	return Files::writeAtomic(path, data.data(), data.size());
+}
+
+IblQuality::Settings IblContainer::settings(const Contents& contents)
+{
+	IblQuality::Settings settings;
+	settings.environmentResolution = contents.environment.width;
+	settings.environmentMipLevels = contents.environment.mipLevels;
+	settings.environmentFormat = contents.environment.internalFormat;
+	settings.preFilterResolution = contents.preFilter.width;
+	settings.preFilterMipLevels = contents.preFilter.mipLevels;
+	settings.preFilterFormat = contents.preFilter.internalFormat;
+
+	return settings;
+}
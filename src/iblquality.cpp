@@ -0,0 +1,90 @@
+#include "iblquality.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Every tier keeps 5 prefilter mips, MAX_REFLECTION_LOD in shaderpbr.fs depends on it
+	const IblQuality::Settings tiers[] =
+	{
+		// LOW
+		{ 256, 9, GL_RGB9_E5, 128, 5, GL_RGB9_E5 },
+		// MEDIUM
+		{ 512, 10, GL_R11F_G11F_B10F, 256, 5, GL_R11F_G11F_B10F },
+		// HIGH_COMPRESSED
+		{ 1024, 11, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB, 1024, 5, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB },
+		// HIGH
+		{ 1024, 11, GL_RGB16F, 1024, 5, GL_RGB16F }
+	};
+}
+
+const IblQuality::Settings& IblQuality::settings(Tier tier)
+{
+	return tiers[tier];
+}
+
+IblQuality::Tier IblQuality::supportedTier(Tier tier, bool bptcSupported)
+{
+	if (tier == HIGH_COMPRESSED && !bptcSupported) {
+		return HIGH;
+	}
+
+	return tier;
+}
+
+GLenum IblQuality::renderFormat(GLenum storageFormat)
+{
+	return storageFormat == GL_RGB9_E5 || isCompressed(storageFormat) ? GL_RGB16F : storageFormat;
+}
+
+bool IblQuality::isCompressed(GLenum format)
+{
+	return format == GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB;
+}
+
+size_t IblQuality::bytesPerTexel(GLenum format)
+{
+	switch (format) {
+	case GL_RGB16F:
+		return 6;
+	case GL_R11F_G11F_B10F:
+	case GL_RGB9_E5:
+		return 4;
+	case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+size_t IblQuality::cubeMapSize(GLenum format, int resolution, int mipLevels)
+{
+	size_t size = 0;
+
+	for (int mip = 0; mip < mipLevels; ++mip) {
+		size_t mipResolution = std::max(1, resolution >> mip);
+
+		// 16 bytes per 4x4 block
+		if (isCompressed(format)) {
+			size_t blocks = (mipResolution + 3) / 4;
+			size += 6 * blocks * blocks * 16;
+		}
+		else {
+			size += 6 * mipResolution * mipResolution * bytesPerTexel(format);
+		}
+	}
+
+	return size;
+}
+
+size_t IblQuality::memorySize(const Settings& settings)
+{
+	return cubeMapSize(settings.environmentFormat, settings.environmentResolution, settings.environmentMipLevels)
+		+ cubeMapSize(settings.preFilterFormat, settings.preFilterResolution, settings.preFilterMipLevels);
+}
+
+glm::ivec2 IblQuality::preFilterLevels(const Settings& settings, const glm::vec2& roughnessRange)
+{
+	glm::vec2 lod = glm::clamp(roughnessRange, 0.0f, 1.0f) * static_cast<float>(settings.preFilterMipLevels - 1);
+
+	return glm::ivec2(static_cast<int>(std::floor(lod.x)), static_cast<int>(std::ceil(lod.y)));
+}
@@ -1,6 +1,8 @@
 #define GLFW_EXPOSE_NATIVE_WIN32
 
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <memory>
 
 #include <windows.h>
@@ -8,6 +10,7 @@
 #include <GLFW\glfw3.h>
 #include <GLFW\glfw3native.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
@@ -17,6 +20,7 @@
 
 #include "droptarget.h"
 #include "shader.h"
+#include "shadervariants.h"
 #include "camera.h"
 #include "texture.h"
 #include "cubemap.h"
@@ -24,6 +28,15 @@
 #include "sphere.h"
 #include "quad.h"
 #include "cubemapgenerator.h"
+#include "environmentbake.h"
+#include "filewatcher.h"
+#include "iblquality.h"
+#include "textureloader.h"
+#include "textureregistry.h"
+#include "uniformblocks.h"
+#include "uniformbuffer.h"
+#include "virtualtexture.h"
+#include "virtualtexturefeedback.h"
 
 namespace MaterialMapPreview {
 	enum Type { ALBEDO, NORMAL, METALLIC, ROUGHNESS, AO, DISPLACEMENT, NONE };
@@ -37,10 +50,20 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void fileDropCallback(const char* path);
 void createFbo(int width, int height);
+const IblQuality::Settings& selectedIblSettings();
+void loadDefaultMaterial();
+void loadOrmMap();
+glm::vec2 spherePixelsPerUv(int framebufferHeight);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+const double BAKE_BUDGET_MS = 4.0; // GPU time per frame given to environment bakes
+const size_t TEXTURE_UPLOAD_BUDGET = 16 * 1024 * 1024; // Texture bytes streamed per frame
+const int VIRTUAL_TILE_BUDGET = 8; // Virtual texture tiles uploaded per frame
+const glm::u8vec4 FLAT_NORMAL(128, 128, 255, 255); // Placeholder texels while a map loads
+const glm::u8vec4 ORM_PLACEHOLDER(255, 128, 0, 255); // Unoccluded, half rough dielectric
+const float SPHERE_RADIUS = 1.0f; // Of the Sphere mesh
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -58,9 +81,20 @@ unsigned int hdrFBO, colorBuffer, renderBuffer;
 // Skybox
 std::unique_ptr<Skybox> skybox = nullptr;
 std::shared_ptr<CubeMap> environmentMap = nullptr;
-std::shared_ptr<CubeMap> irradianceMap = nullptr;
+std::shared_ptr<SphericalHarmonics> irradianceSH = nullptr;
 std::shared_ptr<CubeMap> preFilterMap = nullptr;
 std::shared_ptr<Texture> brdfLUT = nullptr;
+std::unique_ptr<CubeMapGenerator> cubeMapGenerator = nullptr;
+std::unique_ptr<EnvironmentBake> environmentBake = nullptr;
+std::unique_ptr<TextureLoader> textureLoader = nullptr;
+std::unique_ptr<TextureRegistry> textureRegistry = nullptr;
+std::unique_ptr<FileWatcher> fileWatcher = nullptr;
+std::string environmentPath = "textures/default_env.hdr";
+IblQuality::Settings iblSettings = IblQuality::settings(IblQuality::HIGH); // Of the maps currently displayed
+glm::ivec2 requestedPreFilterLevels = glm::ivec2(0, -1); // Last fill of the current prefilter map
+uint64_t watchedRevision = std::numeric_limits<uint64_t>::max(); // Registry revision and environment the watcher was given
+std::string watchedEnvironmentPath;
+bool environmentChanged = false; // The displayed environment changed on disk, rebaked once no bake is pending
 
 // Geometry
 std::unique_ptr<Sphere> sphere = nullptr;
@@ -69,14 +103,19 @@ std::unique_ptr<Quad> quad = nullptr;
 
 // Material
 std::shared_ptr<Texture> albedoMap = nullptr;
+std::shared_ptr<VirtualTexture> virtualAlbedoMap = nullptr; // Replaces albedoMap when set
+std::unique_ptr<VirtualTextureFeedback> virtualFeedback = nullptr;
+std::vector<uint16_t> feedbackTexels;
 std::shared_ptr<Texture> normalMap = nullptr;
-std::shared_ptr<Texture> metallicMap = nullptr;
-std::shared_ptr<Texture> roughnessMap = nullptr;
-std::shared_ptr<Texture> aoMap = nullptr;
+std::shared_ptr<Texture> ormMap = nullptr; // AO, roughness and metallic packed in one texture
+std::string aoPath;
+std::string roughnessPath;
+std::string metallicPath;
 std::shared_ptr<Texture> displacementMap = nullptr;
 
 // Dear ImGui
 int skyboxComboItem = 0;
+int iblQualityComboItem = IblQuality::HIGH;
 int textureScale[2] = { 1, 1 };
 float lightPos[3] = { 2.0, 0.0, 2.0 };
 bool showAppControls = true;
@@ -139,11 +178,15 @@ int main()
 	ImGui_ImplOpenGL3_Init(glslVersion);
 
 	Shader shaderSingleColor("shaders/shadersinglecolor.vs", "shaders/shadersinglecolor.fs");
-	Shader shaderWireframe("shaders/shaderwireframe.vs", "shaders/shaderwireframe.fs");
+	ShaderVariants shaderWireframeVariants("shaders/shaderwireframe.vs", "shaders/shaderwireframe.fs", Material::shaderDefines);
 	Shader shaderScreen("shaders/shaderscreen.vs", "shaders/shaderscreen.fs");
 	Shader shaderSkybox("shaders/shaderskybox.vs", "shaders/shaderskybox.fs");
-	Shader shaderPBR("shaders/shaderpbr.vs", "shaders/shaderpbr.fs");
 
+	// Variants follow the material maps (see Material::shaderVariant), the feedback pass of a
+	// virtual albedo map shares the PBR vertex stage
+	ShaderVariants shaderPBRVariants("shaders/shaderpbr.vs", "shaders/shaderpbr.fs", Material::shaderDefines);
+	ShaderVariants shaderFeedbackVariants("shaders/shaderpbr.vs", "shaders/shaderfeedback.fs", Material::shaderDefines);
+	UniformBuffer frameUniforms(sizeof(UniformBlocks::FrameData));
 
 	// Initialize geometry
 	sphere = std::make_unique<Sphere>();
@@ -153,30 +196,31 @@ int main()
 	// load and create textures 
 	// -------------------------
 
-	albedoMap = std::make_shared<Texture>("textures/albedo.png", true);
-	normalMap = std::make_shared<Texture>("textures/normal.png");
-	metallicMap = std::make_shared<Texture>("textures/metal.png");
-	roughnessMap = std::make_shared<Texture>("textures/rough.png");
-	aoMap = std::make_shared<Texture>("textures/ao.png");
-	displacementMap = std::make_shared<Texture>("textures/height.png");
+	textureLoader = std::make_unique<TextureLoader>();
+	virtualFeedback = std::make_unique<VirtualTextureFeedback>();
+	textureRegistry = std::make_unique<TextureRegistry>(*textureLoader);
+	fileWatcher = std::make_unique<FileWatcher>();
+	loadDefaultMaterial();
 
+	// The default environment is baked up front, there is nothing to show until then
+	cubeMapGenerator = std::make_unique<CubeMapGenerator>();
 	{
-		CubeMapGenerator cubeMapGenerator;
-		environmentMap = cubeMapGenerator.generateEnvironmentMap("textures/default_env.hdr");
-		irradianceMap = cubeMapGenerator.generateIrradianceMap(environmentMap);
-		preFilterMap = cubeMapGenerator.generatePreFilterMap(environmentMap);
-		brdfLUT = cubeMapGenerator.generateBrdfLUT();
+		EnvironmentBake bake(*cubeMapGenerator, environmentPath, selectedIblSettings());
+		bake.finish();
+		iblSettings = bake.getSettings();
+		environmentMap = bake.getEnvironmentMap();
+		irradianceSH = bake.getIrradianceSH();
+		preFilterMap = bake.getPreFilterMap();
+		brdfLUT = cubeMapGenerator->generateBrdfLUT();
 	}
 
 	sphere->setAlbedoMap(albedoMap);
 	sphere->setNormalMap(normalMap);
-	sphere->setMetallicMap(metallicMap);
-	sphere->setRoughnessMap(roughnessMap);
-	sphere->setAoMap(aoMap);
+	sphere->setOrmMap(ormMap);
 	sphere->setDisplacementMap(displacementMap);
 	sphere->setTextureScale(1, 1);
 
-	sphere->setIrradianceMap(irradianceMap);
+	sphere->setIrradianceSH(irradianceSH);
 	sphere->setPreFilterMap(preFilterMap);
 	sphere->setBrdfLUT(brdfLUT);
 
@@ -238,7 +282,9 @@ int main()
 
 			ImGui::BeginGroup();
 			ImGui::Text("    Albedo");
-			ImGui::Image((ImTextureID)albedoMap->getId(), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1), ImVec4(1.0f, 1.0f, 1.0f, 1.0f), ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
+			// A virtual map previews its tile cache
+			GLuint albedoPreview = virtualAlbedoMap ? virtualAlbedoMap->getCacheId() : albedoMap->getId();
+			ImGui::Image((ImTextureID)albedoPreview, ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1), ImVec4(1.0f, 1.0f, 1.0f, 1.0f), ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
 
 			if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem | ImGuiHoveredFlags_AllowWhenOverlapped) && dropTarget.AcceptFormat()) {
 				ImRect r(ImGui::GetItemRectMin(), ImGui::GetItemRectMax());
@@ -266,7 +312,8 @@ int main()
 			ImGui::SameLine();
 			ImGui::BeginGroup();
 			ImGui::Text("   Metallic");
-			ImGui::Image((ImTextureID)metallicMap->getId(), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1), ImVec4(1.0f, 1.0f, 1.0f, 1.0f), ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
+			// Metallic, roughness and AO are previewed through their channel of the packed map
+			ImGui::Image((ImTextureID)ormMap->getId(), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1), ImVec4(0.0f, 0.0f, 1.0f, 1.0f), ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
 
 			if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem | ImGuiHoveredFlags_AllowWhenOverlapped) && dropTarget.AcceptFormat()) {
 				ImRect r(ImGui::GetItemRectMin(), ImGui::GetItemRectMax());
@@ -280,7 +327,7 @@ int main()
 			ImGui::SameLine();
 			ImGui::BeginGroup();
 			ImGui::Text("   Roughness");
-			ImGui::Image((ImTextureID)roughnessMap->getId(), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1), ImVec4(1.0f, 1.0f, 1.0f, 1.0f), ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
+			ImGui::Image((ImTextureID)ormMap->getId(), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1), ImVec4(0.0f, 1.0f, 0.0f, 1.0f), ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
 
 			if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem | ImGuiHoveredFlags_AllowWhenOverlapped) && dropTarget.AcceptFormat()) {
 				ImRect r(ImGui::GetItemRectMin(), ImGui::GetItemRectMax());
@@ -294,7 +341,7 @@ int main()
 			ImGui::SameLine();
 			ImGui::BeginGroup();
 			ImGui::Text("      AO");
-			ImGui::Image((ImTextureID)aoMap->getId(), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1), ImVec4(1.0f, 1.0f, 1.0f, 1.0f), ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
+			ImGui::Image((ImTextureID)ormMap->getId(), ImVec2(100, 100), ImVec2(0, 0), ImVec2(1, 1), ImVec4(1.0f, 0.0f, 0.0f, 1.0f), ImVec4(1.0f, 1.0f, 1.0f, 0.5f));
 
 			if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem | ImGuiHoveredFlags_AllowWhenOverlapped) && dropTarget.AcceptFormat()) {
 				ImRect r(ImGui::GetItemRectMin(), ImGui::GetItemRectMax());
@@ -324,7 +371,7 @@ int main()
 
 		// Controls window
 		if (showAppControls) {
-			ImGui::SetNextWindowSize(ImVec2(250, 240), ImGuiCond_FirstUseEver);
+			ImGui::SetNextWindowSize(ImVec2(250, 263), ImGuiCond_FirstUseEver);
 			ImGui::SetNextWindowPos(ImVec2(10, 195), ImGuiCond_FirstUseEver);
 			ImGui::Begin("Controls", &showAppControls, ImGuiWindowFlags_NoResize);
 			ImGui::SetNextItemWidth(120);
@@ -333,13 +380,15 @@ int main()
 				glfwSwapInterval(vsyncEnabled);
 			}
 
-			if (ImGui::Combo("Skybox", &skyboxComboItem, "Environment\0Irradiance\0\0")) {
-				if (skyboxComboItem == 0) {
-					skybox->setEnvironmentMap(environmentMap);
-				}
-				else if (skyboxComboItem == 1) {
-					skybox->setEnvironmentMap(irradianceMap);
-				}
+			ImGui::Combo("Skybox", &skyboxComboItem, "Environment\0Irradiance\0\0");
+
+			ImGui::SetNextItemWidth(120);
+
+			if (ImGui::Combo("IBL quality", &iblQualityComboItem, "Low\0Medium\0High (BC6H)\0High\0\0")) {
+				// Rebakes the maps whose settings changed, a pending bake of another image is kept
+				std::string path = environmentBake ? environmentBake->getImagePath() : environmentPath;
+				environmentBake = std::make_unique<EnvironmentBake>(*cubeMapGenerator, path, selectedIblSettings(),
+					environmentMap, irradianceSH, preFilterMap, sphere->getRoughnessRange());
 			}
 
 			ImGui::SetNextItemWidth(120);
@@ -351,18 +400,12 @@ int main()
 			}
 
 			if (ImGui::Button("Reset material to default")) {
-				albedoMap = std::make_shared<Texture>("textures/albedo.png", true);
-				normalMap = std::make_shared<Texture>("textures/normal.png");
-				metallicMap = std::make_shared<Texture>("textures/metal.png");
-				roughnessMap = std::make_shared<Texture>("textures/rough.png");
-				aoMap = std::make_shared<Texture>("textures/ao.png");
-				displacementMap = std::make_shared<Texture>("textures/height.png");
+				loadDefaultMaterial();
 
 				sphere->setAlbedoMap(albedoMap);
+				sphere->setVirtualAlbedoMap(virtualAlbedoMap);
 				sphere->setNormalMap(normalMap);
-				sphere->setMetallicMap(metallicMap);
-				sphere->setRoughnessMap(roughnessMap);
-				sphere->setAoMap(aoMap);
+				sphere->setOrmMap(ormMap);
 				sphere->setDisplacementMap(displacementMap);
 			}
 
@@ -388,6 +431,24 @@ int main()
 				ImGui::Text("%.3f ms/frame", 1000.0f / ImGui::GetIO().Framerate);
 				ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
 
+				ImGui::Text("IBL memory: %.1f MB", IblQuality::memorySize(iblSettings) / (1024.0 * 1024.0));
+
+				if (environmentBake) {
+					ImGui::Text("Baking environment: %.0f%%", environmentBake->getProgress() * 100.0f);
+				}
+
+				ImGui::Text("Textures: %zu resident, %u hits, %u misses", textureRegistry->getResidentCount(), textureRegistry->getHits(), textureRegistry->getMisses());
+
+				if (virtualAlbedoMap) {
+					ImGui::Text("Virtual tiles: %zu resident", virtualAlbedoMap->getResidentCount());
+				}
+
+				ImGui::Text("Texture memory: %.1f MB", textureLoader->getResidentBytes() / (1024.0 * 1024.0));
+
+				if (textureLoader->isLoading()) {
+					ImGui::Text("Loading textures...");
+				}
+
 				if (ImGui::IsMousePosValid()) {
 					ImGui::Text("Mouse Position: (%.1f,%.1f)", io.MousePos.x, io.MousePos.y);
 				}
@@ -404,6 +465,71 @@ int main()
 		processKeyboardInput(window, !io.WantCaptureKeyboard);
 		processMouseInput(window, !io.WantCaptureMouse);
 
+		// Material maps and environments edited in other applications are read again. The watched
+		// files only change with the registry contents or the environment.
+		if (textureRegistry->getRevision() != watchedRevision || environmentPath != watchedEnvironmentPath) {
+			watchedRevision = textureRegistry->getRevision();
+			watchedEnvironmentPath = environmentPath;
+
+			std::vector<std::string> watchedPaths = textureRegistry->getPaths();
+			watchedPaths.push_back(environmentPath);
+			fileWatcher->setPaths(watchedPaths);
+		}
+
+		for (const std::string& path : fileWatcher->takeChanged()) {
+			if (path == environmentPath) {
+				environmentChanged = true;
+			}
+			else {
+				textureRegistry->reload(path);
+			}
+		}
+
+		// Stream decoded material textures, only the levels the sphere needs at its size on screen
+		int framebufferWidth, framebufferHeight;
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+		textureLoader->setPixelsPerUv(spherePixelsPerUv(framebufferHeight));
+		textureLoader->update(TEXTURE_UPLOAD_BUDGET);
+		textureRegistry->update();
+
+		// Advance the environment bake, the current maps stay bound until the new set is complete
+		if (environmentBake && environmentBake->update(BAKE_BUDGET_MS)) {
+			if (environmentBake->succeeded()) {
+				environmentChanged = environmentChanged && environmentBake->getImagePath() == environmentPath;
+				environmentPath = environmentBake->getImagePath();
+				iblSettings = environmentBake->getSettings();
+				environmentMap = environmentBake->getEnvironmentMap();
+				irradianceSH = environmentBake->getIrradianceSH();
+				preFilterMap = environmentBake->getPreFilterMap();
+
+				skybox->setEnvironmentMap(environmentMap);
+				sphere->setIrradianceSH(irradianceSH);
+				sphere->setPreFilterMap(preFilterMap);
+				requestedPreFilterLevels = glm::ivec2(0, -1);
+			}
+
+			environmentBake = nullptr;
+		}
+
+		// An edited environment waits for the pending bake, whether it changes the quality, fills
+		// prefilter mips or loads another image. It's dropped if another image replaced it.
+		if (environmentChanged && !environmentBake) {
+			environmentChanged = false;
+			environmentBake = std::make_unique<EnvironmentBake>(*cubeMapGenerator, environmentPath, selectedIblSettings(),
+				environmentMap, irradianceSH, preFilterMap, sphere->getRoughnessRange());
+		}
+
+		// Prefilter mips a rougher material reaches are baked on top of the current ones. A failed
+		// fill isn't retried until the material needs other mips.
+		glm::vec2 roughnessRange = sphere->getRoughnessRange();
+		glm::ivec2 preFilterLevels = IblQuality::preFilterLevels(iblSettings, roughnessRange);
+
+		if (!environmentBake && !preFilterMap->hasBakedLevels(preFilterLevels.x, preFilterLevels.y) && preFilterLevels != requestedPreFilterLevels) {
+			requestedPreFilterLevels = preFilterLevels;
+			environmentBake = std::make_unique<EnvironmentBake>(*cubeMapGenerator, environmentPath, iblSettings,
+				environmentMap, irradianceSH, preFilterMap, roughnessRange);
+		}
+
 		// Render commands
 		// bind to framebuffer and draw scene as we normally would to color texture 
 		glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
@@ -430,26 +556,28 @@ int main()
 			projection = glm::perspective(glm::radians(camera.mZoom), (float)width / (float)height, 0.1f, 100.0f);
 		}
 
+		// Camera and lighting shared by every program, written only when they change
+		UniformBlocks::FrameData frameData = {};
+		frameData.view = view;
+		frameData.projection = projection;
+		frameData.eyePos = camera.mPosition;
+		frameData.lightEnabled = lightEnabled;
+		frameData.lightPos = glm::vec3(lightPos[0], lightPos[1], lightPos[2]);
+		frameUniforms.update(&frameData);
+		frameUniforms.bind(UniformBlocks::FRAME_BINDING_POINT);
+
 		// Render light
 		if (lightEnabled) {
 			shaderSingleColor.use();
-			shaderSingleColor.setMat4("view", view);
-			shaderSingleColor.setMat4("projection", projection);
 			shaderSingleColor.setVec3("color", 100.0, 100.0, 100.0);
 
 			glm::mat4 model = glm::mat4(1.0f);
 			model = glm::translate(model, glm::vec3(lightPos[0], lightPos[1], lightPos[2]));
 			model = glm::scale(model, glm::vec3(0.25f, 0.25f, 0.25f));
-			shaderSingleColor.setMat4("model", model);
+			light->setTransform(model);
 			light->draw(shaderSingleColor);
 		}
 
-		// Render object
-		shaderPBR.use();
-		shaderPBR.setMat4("view", view);
-		shaderPBR.setMat4("projection", projection);
-		shaderPBR.setVec3("eyePos", camera.mPosition);
-
 		glm::mat4 model = glm::mat4(1.0f);
 
 		if (rotationEnabled) {
@@ -457,25 +585,43 @@ int main()
 		}
 
 		model = glm::rotate(model, rotationAngle, glm::vec3(0.0, 1.0, 0.0));
-		shaderPBR.setMat4("model", model);
-		glm::mat3 normalMat = glm::mat3(glm::transpose(glm::inverse(model)));
-		shaderPBR.setMat3("normalMat", normalMat);
-		shaderPBR.setFloat("displacementAmount", displacementAmount);
-		shaderPBR.setBool("lightEnabled", lightEnabled);
-		shaderPBR.setVec3("lightPos", lightPos[0], lightPos[1], lightPos[2]);
-		sphere->draw(shaderPBR);
+		sphere->setTransform(model, displacementAmount);
+
+		// Constant maps are only known once loaded, the variant can change from one frame to the next
+		unsigned int materialVariant = sphere->shaderVariant();
+
+		// Tiles of the virtual albedo map the sphere samples, they are requested once read back
+		if (virtualAlbedoMap) {
+			if (virtualFeedback->read(feedbackTexels)) {
+				virtualAlbedoMap->requestTiles(feedbackTexels);
+			}
+
+			virtualAlbedoMap->update(VIRTUAL_TILE_BUDGET);
+
+			virtualFeedback->begin(width, height);
+			const Shader& shaderFeedback = shaderFeedbackVariants.get(materialVariant);
+			shaderFeedback.use();
+			shaderFeedback.setVec4("virtualParameters", virtualAlbedoMap->getParameters());
+			shaderFeedback.setFloat("lodBias", virtualFeedback->getLodBias());
+			sphere->draw(shaderFeedback);
+			virtualFeedback->end();
+
+			glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+			glViewport(0, 0, width, height);
+		}
+
+		// Render object
+		const Shader& shaderObject = shaderPBRVariants.get(materialVariant);
+		sphere->draw(shaderObject);
 
 		if (wireframeEnabled) {
 			// Render Wireframe
 			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 			glEnable(GL_POLYGON_OFFSET_FILL);
 			glPolygonOffset(-1, -1);
+			const Shader& shaderWireframe = shaderWireframeVariants.get(materialVariant);
 			shaderWireframe.use();
-			shaderWireframe.setMat4("model", model);
-			shaderWireframe.setMat4("view", view);
-			shaderWireframe.setMat4("projection", projection);
 			shaderWireframe.setVec3("color", 0.3f, 1.0f, 0.5f);
-			shaderWireframe.setFloat("displacementAmount", displacementAmount);
 			sphere->draw(shaderWireframe);
 			glDisable(GL_POLYGON_OFFSET_FILL);
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -484,9 +630,8 @@ int main()
 		// Render skybox
 		// -------------
 		shaderSkybox.use();
-		view = glm::mat4(glm::mat3(camera.getViewMatrix()));
-		shaderSkybox.setMat4("view", view);
-		shaderSkybox.setMat4("projection", projection);
+		shaderSkybox.setBool("showIrradiance", skyboxComboItem == 1);
+		irradianceSH->bind(SphericalHarmonics::BINDING_POINT);
 		skybox->draw(shaderSkybox);
 
 		// Render quad with scene's visuals as its texture image
@@ -512,6 +657,13 @@ int main()
 
 	// Cleanup
 	RevokeDragDrop(hwnd);
+	fileWatcher = nullptr;
+	textureRegistry = nullptr;
+	textureLoader = nullptr;
+	virtualAlbedoMap = nullptr;
+	virtualFeedback = nullptr;
+	environmentBake = nullptr;
+	cubeMapGenerator = nullptr;
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -577,48 +729,77 @@ void fileDropCallback(const char* path)
 {
 	switch (hoveredPreviewItem) {
 	case MaterialMapPreview::ALBEDO:
-		albedoMap = std::make_shared<Texture>(path, true);
+		// Tile files stream into a virtual texture, the current map stays if one can't be opened
+		if (VirtualTextureFile::isTileFile(path)) {
+			std::shared_ptr<VirtualTexture> virtualTexture = std::make_shared<VirtualTexture>();
+
+			if (virtualTexture->open(path)) {
+				virtualAlbedoMap = virtualTexture;
+				sphere->setVirtualAlbedoMap(virtualAlbedoMap);
+			}
+
+			break;
+		}
+
+		albedoMap = textureRegistry->acquire(path, TextureLoader::COLOR);
+		virtualAlbedoMap = nullptr;
 		sphere->setAlbedoMap(albedoMap);
+		sphere->setVirtualAlbedoMap(nullptr);
 		break;
 	case MaterialMapPreview::NORMAL:
-		normalMap = std::make_shared<Texture>(path);
+		normalMap = textureRegistry->acquire(path, TextureLoader::NORMAL, FLAT_NORMAL);
 		sphere->setNormalMap(normalMap);
 		break;
 	case MaterialMapPreview::METALLIC:
-		metallicMap = std::make_shared<Texture>(path);
-		sphere->setMetallicMap(metallicMap);
+		metallicPath = path;
+		loadOrmMap();
+		sphere->setOrmMap(ormMap);
 		break;
 	case MaterialMapPreview::ROUGHNESS:
-		roughnessMap = std::make_shared<Texture>(path);
-		sphere->setRoughnessMap(roughnessMap);
+		roughnessPath = path;
+		loadOrmMap();
+		sphere->setOrmMap(ormMap);
 		break;
 	case MaterialMapPreview::AO:
-		aoMap = std::make_shared<Texture>(path);
-		sphere->setAoMap(aoMap);
+		aoPath = path;
+		loadOrmMap();
+		sphere->setOrmMap(ormMap);
 		break;
 	case MaterialMapPreview::DISPLACEMENT:
-		displacementMap = std::make_shared<Texture>(path);
+		displacementMap = textureRegistry->acquire(path, TextureLoader::HEIGHT);
 		sphere->setDisplacementMap(displacementMap);
 		break;
 	default:
-		// Load new cube maps
-		CubeMapGenerator generator;
-		environmentMap = generator.generateEnvironmentMap(path);
-		irradianceMap = generator.generateIrradianceMap(environmentMap);
-		preFilterMap = generator.generatePreFilterMap(environmentMap);
-		
-		if (skyboxComboItem == 0) {
-			skybox->setEnvironmentMap(environmentMap);
-		}
-		else if (skyboxComboItem == 1) {
-			skybox->setEnvironmentMap(irradianceMap);
-		}
-		
-		sphere->setIrradianceMap(irradianceMap);
-		sphere->setPreFilterMap(preFilterMap);
+		// Bake new cube maps over the next frames, a pending bake is dropped
+		environmentBake = std::make_unique<EnvironmentBake>(*cubeMapGenerator, path, selectedIblSettings(),
+			environmentMap, irradianceSH, preFilterMap, sphere->getRoughnessRange());
 	}
 }
 
+void loadDefaultMaterial()
+{
+	// Resident maps are shared, the others are decoded in parallel and show a placeholder until uploaded
+	albedoMap = textureRegistry->acquire("textures/albedo.png", TextureLoader::COLOR);
+	virtualAlbedoMap = nullptr;
+	normalMap = textureRegistry->acquire("textures/normal.png", TextureLoader::NORMAL, FLAT_NORMAL);
+	metallicPath = "textures/metal.png";
+	roughnessPath = "textures/rough.png";
+	aoPath = "textures/ao.png";
+	loadOrmMap();
+	displacementMap = textureRegistry->acquire("textures/height.png", TextureLoader::HEIGHT);
+}
+
+void loadOrmMap()
+{
+	// Dropping a single map repacks it with the two others
+	ormMap = textureRegistry->acquirePacked(aoPath, roughnessPath, metallicPath, ORM_PLACEHOLDER);
+}
+
+const IblQuality::Settings& selectedIblSettings()
+{
+	return IblQuality::settings(IblQuality::supportedTier(static_cast<IblQuality::Tier>(iblQualityComboItem), GLAD_GL_ARB_texture_compression_bptc));
+}
+
 void createFbo(int width, int height)
 {
 	glDeleteTextures(1, &colorBuffer);
@@ -651,4 +832,19 @@ void createFbo(int width, int height)
 	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Screen pixels covered by the texture coordinates at the point of the sphere closest to the camera
+glm::vec2 spherePixelsPerUv(int framebufferHeight)
+{
+	float distance = glm::length(camera.mPosition) - SPHERE_RADIUS;
+
+	if (framebufferHeight <= 0 || distance <= 0.0f) {
+		return glm::vec2(std::numeric_limits<float>::max());
+	}
+
+	float pixelsPerUnit = framebufferHeight / (2.0f * distance * std::tan(glm::radians(camera.mZoom) * 0.5f));
+
+	// U wraps around the equator, V goes from pole to pole
+	return glm::vec2(2.0f * glm::pi<float>() * SPHERE_RADIUS / textureScale[0], glm::pi<float>() * SPHERE_RADIUS / textureScale[1]) * pixelsPerUnit;
 }
\ No newline at end of file
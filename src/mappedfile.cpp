@@ -0,0 +1,129 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	// Empty files can't be mapped
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (mapping == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFileHandle = file;
+	mMappingHandle = mapping;
+	mData = static_cast<const char*>(view);
+	mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+
+	if (file < 0) {
+		return false;
+	}
+
+	struct stat fileStat;
+
+	// Empty files can't be mapped
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+		::close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	mData = static_cast<const char*>(view);
+	mSize = static_cast<size_t>(fileStat.st_size);
+#endif
+
+	mMapped = true;
+	return true;
+}
+
+void MappedFile::assign(const char* data, size_t size)
+{
+	close();
+	mData = data;
+	mSize = size;
+}
+
+void MappedFile::close()
+{
+	if (mMapped) {
+#ifdef _WIN32
+		UnmapViewOfFile(mData);
+		CloseHandle(mMappingHandle);
+		CloseHandle(mFileHandle);
+		mMappingHandle = nullptr;
+		mFileHandle = nullptr;
+#else
+		munmap(const_cast<char*>(mData), mSize);
+#endif
+	}
+
+	mData = nullptr;
+	mSize = 0;
+	mMapped = false;
+}
+
+bool MappedFile::isOpen() const
+{
+	return mData != nullptr;
+}
+
+const char* MappedFile::data() const
+{
+	return mData;
+}
+
+size_t MappedFile::size() const
+{
+	return mSize;
+}
@@ -1,49 +1,131 @@
 #include "material.h"
+#include "uniformblocks.h"
 
-Material::Material()
+Material::Material() : mMaterialUniforms(sizeof(UniformBlocks::MaterialData))
 {}
 
+namespace {
+	// Constant maps are read from their value in the MaterialData block, the shader variant doesn't sample them
+	void useMap(const Shader& shader, UniformName name, const std::shared_ptr<Texture>& map, glm::vec4& value, unsigned int &textureUnit)
+	{
+		if (map == nullptr) {
+			return;
+		}
+
+		if (map->isConstant()) {
+			value = map->getConstantValue();
+			return;
+		}
+
+		shader.setInt(name + "Map", textureUnit);
+		map->bind(GL_TEXTURE0 + textureUnit);
+		textureUnit++;
+	}
+
+	unsigned int constantFlag(Material::ShaderVariant flag, const std::shared_ptr<Texture>& map)
+	{
+		return map != nullptr && map->isConstant() ? flag : 0;
+	}
+}
+
 void Material::use(const Shader& shader, unsigned int &textureUnit) const
 {
-	shader.setVec2("textureScale", mTextureScale);
+	UniformBlocks::MaterialData data = {};
+	data.textureScale = mTextureScale;
 
-	if (mAlbedoMap != nullptr) {
-		shader.setInt("albedoMap", textureUnit);
-		mAlbedoMap->bind(GL_TEXTURE0 + textureUnit);
-		textureUnit++;
+	if (mVirtualAlbedoMap != nullptr) {
+		mVirtualAlbedoMap->bind(shader, "albedo", textureUnit);
+	}
+	else {
+		useMap(shader, "albedo", mAlbedoMap, data.albedoValue, textureUnit);
 	}
 
-	if (mNormalMap != nullptr) {
-		shader.setInt("normalMap", textureUnit);
-		mNormalMap->bind(GL_TEXTURE0 + textureUnit);
-		textureUnit++;
+	useMap(shader, "normal", mNormalMap, data.normalValue, textureUnit);
+
+	if (mOrmMap != nullptr) {
+		useMap(shader, "orm", mOrmMap, data.ormValue, textureUnit);
+	}
+	else {
+		useMap(shader, "metallic", mMetallicMap, data.metallicValue, textureUnit);
+		useMap(shader, "roughness", mRoughnessMap, data.roughnessValue, textureUnit);
+		useMap(shader, "ao", mAoMap, data.aoValue, textureUnit);
 	}
 
-	if (mMetallicMap != nullptr) {
-		shader.setInt("metallicMap", textureUnit);
-		mMetallicMap->bind(GL_TEXTURE0 + textureUnit);
-		textureUnit++;
+	useMap(shader, "displacement", mDisplacementMap, data.displacementValue, textureUnit);
+
+	mMaterialUniforms.update(&data);
+	mMaterialUniforms.bind(UniformBlocks::MATERIAL_BINDING_POINT);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+unsigned int Material::shaderVariant() const
+{
+	unsigned int variant = 0;
+
+	if (mVirtualAlbedoMap != nullptr) {
+		variant |= VIRTUAL_ALBEDO;
+	}
+	else {
+		variant |= constantFlag(CONSTANT_ALBEDO, mAlbedoMap);
 	}
 
-	if (mRoughnessMap != nullptr) {
-		shader.setInt("roughnessMap", textureUnit);
-		mRoughnessMap->bind(GL_TEXTURE0 + textureUnit);
-		textureUnit++;
+	variant |= constantFlag(CONSTANT_NORMAL, mNormalMap);
+
+	if (mOrmMap != nullptr) {
+		variant |= PACKED_ORM | constantFlag(CONSTANT_ORM, mOrmMap);
+	}
+	else {
+		variant |= constantFlag(CONSTANT_METALLIC, mMetallicMap);
+		variant |= constantFlag(CONSTANT_ROUGHNESS, mRoughnessMap);
+		variant |= constantFlag(CONSTANT_AO, mAoMap);
 	}
 
-	if (mAoMap != nullptr) {
-		shader.setInt("aoMap", textureUnit);
-		mAoMap->bind(GL_TEXTURE0 + textureUnit);
-		textureUnit++;
+	variant |= constantFlag(CONSTANT_DISPLACEMENT, mDisplacementMap);
+
+	return variant;
+}
+
+std::vector<std::string> Material::shaderDefines(unsigned int variant)
+{
+	const std::pair<ShaderVariant, const char*> flags[] = {
+		{ VIRTUAL_ALBEDO, "VIRTUAL_ALBEDO" },
+		{ PACKED_ORM, "PACKED_ORM" },
+		{ CONSTANT_ALBEDO, "CONSTANT_ALBEDO" },
+		{ CONSTANT_NORMAL, "CONSTANT_NORMAL" },
+		{ CONSTANT_ORM, "CONSTANT_ORM" },
+		{ CONSTANT_METALLIC, "CONSTANT_METALLIC" },
+		{ CONSTANT_ROUGHNESS, "CONSTANT_ROUGHNESS" },
+		{ CONSTANT_AO, "CONSTANT_AO" },
+		{ CONSTANT_DISPLACEMENT, "CONSTANT_DISPLACEMENT" }
+	};
+
+	std::vector<std::string> defines;
+
+	if (variant & VIRTUAL_ALBEDO) {
+		defines = VirtualTexture::shaderDefines();
 	}
 
-	if (mDisplacementMap != nullptr) {
-		shader.setInt("displacementMap", textureUnit);
-		mDisplacementMap->bind(GL_TEXTURE0 + textureUnit);
-		textureUnit++;
+	for (const auto& flag : flags) {
+		if (variant & flag.first) {
+			defines.push_back(flag.second);
+		}
 	}
 
-	glActiveTexture(GL_TEXTURE0);
+	return defines;
+}
+
+glm::vec2 Material::getRoughnessRange() const
+{
+	// Packed maps hold roughness in their green channel
+	if (mOrmMap != nullptr) {
+		return glm::vec2(mOrmMap->getMinValue().g, mOrmMap->getMaxValue().g);
+	}
+
+	if (mRoughnessMap != nullptr) {
+		return glm::vec2(mRoughnessMap->getMinValue().r, mRoughnessMap->getMaxValue().r);
+	}
+
+	return glm::vec2(0.0f, 1.0f);
 }
 
 void Material::setAlbedoMap(std::shared_ptr<Texture> albedoMap)
@@ -51,6 +133,16 @@ void Material::setAlbedoMap(std::shared_ptr<Texture> albedoMap)
 	mAlbedoMap = albedoMap;
 }
 
+void Material::setVirtualAlbedoMap(std::shared_ptr<VirtualTexture> virtualAlbedoMap)
+{
+	mVirtualAlbedoMap = virtualAlbedoMap;
+}
+
+bool Material::hasVirtualAlbedoMap() const
+{
+	return mVirtualAlbedoMap != nullptr;
+}
+
 void Material::setNormalMap(std::shared_ptr<Texture> normalMap)
 {
 	mNormalMap = normalMap;
@@ -71,6 +163,16 @@ void Material::setAoMap(std::shared_ptr<Texture> aoMap)
 	mAoMap = aoMap;
 }
 
+void Material::setOrmMap(std::shared_ptr<Texture> ormMap)
+{
+	mOrmMap = ormMap;
+}
+
+bool Material::hasOrmMap() const
+{
+	return mOrmMap != nullptr;
+}
+
 void Material::setDisplacementMap(std::shared_ptr<Texture> displacementMap)
 {
 	mDisplacementMap = displacementMap;
@@ -1,6 +1,7 @@
 #include "mesh.h"
+#include "uniformblocks.h"
 
-Mesh::Mesh()
+Mesh::Mesh() : mObjectUniforms(sizeof(UniformBlocks::ObjectData))
 {}
 
 Mesh::~Mesh()
@@ -9,6 +10,7 @@ Mesh::~Mesh()
 void Mesh::draw(const Shader& shader) const
 {
 	shader.use();
+	mObjectUniforms.bind(UniformBlocks::OBJECT_BINDING_POINT);
 
 	// draw mesh
 	glBindVertexArray(mVAO);
@@ -16,6 +18,18 @@ void Mesh::draw(const Shader& shader) const
 	glBindVertexArray(0);
 }
 
+void Mesh::setTransform(const glm::mat4& model, float displacementAmount)
+{
+	glm::mat3 normalMat = glm::mat3(glm::transpose(glm::inverse(model)));
+
+	UniformBlocks::ObjectData data = {};
+	data.model = model;
+	data.normalMat[0] = glm::vec4(normalMat[0], 0.0f);
+	data.normalMat[1] = glm::vec4(normalMat[1], 0.0f);
+	data.normalMat[2] = glm::vec4(normalMat[2], 0.0f);
+	data.displacementAmount = displacementAmount;
+	mObjectUniforms.update(&data);
+}
 
 void Mesh::setupMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
 {
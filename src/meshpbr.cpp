@@ -22,10 +22,8 @@ void MeshPBR::draw(const Shader& shader) const
 		textureUnit++;
 	}
 
-	if (mIrradianceMap != nullptr) {
-		mIrradianceMap->bind(GL_TEXTURE0 + textureUnit);
-		shader.setInt("irradianceMap", textureUnit);
-		textureUnit++;
+	if (mIrradianceSH != nullptr) {
+		mIrradianceSH->bind(SphericalHarmonics::BINDING_POINT);
 	}
 
 	if (mPreFilterMap != nullptr) {
@@ -37,11 +35,31 @@ void MeshPBR::draw(const Shader& shader) const
 	Mesh::draw(shader);
 }
 
+unsigned int MeshPBR::shaderVariant() const
+{
+	return mMaterial.shaderVariant();
+}
+
+glm::vec2 MeshPBR::getRoughnessRange() const
+{
+	return mMaterial.getRoughnessRange();
+}
+
 void MeshPBR::setAlbedoMap(std::shared_ptr<Texture> albedoMap)
 {
 	mMaterial.setAlbedoMap(albedoMap);
 }
 
+void MeshPBR::setVirtualAlbedoMap(std::shared_ptr<VirtualTexture> virtualAlbedoMap)
+{
+	mMaterial.setVirtualAlbedoMap(virtualAlbedoMap);
+}
+
+bool MeshPBR::hasVirtualAlbedoMap() const
+{
+	return mMaterial.hasVirtualAlbedoMap();
+}
+
 void MeshPBR::setNormalMap(std::shared_ptr<Texture> normalMap)
 {
 	mMaterial.setNormalMap(normalMap);
@@ -62,6 +80,16 @@ void MeshPBR::setAoMap(std::shared_ptr<Texture> aoMap)
 	mMaterial.setAoMap(aoMap);
 }
 
+void MeshPBR::setOrmMap(std::shared_ptr<Texture> ormMap)
+{
+	mMaterial.setOrmMap(ormMap);
+}
+
+bool MeshPBR::hasOrmMap() const
+{
+	return mMaterial.hasOrmMap();
+}
+
 void MeshPBR::setDisplacementMap(std::shared_ptr<Texture> displacementMap)
 {
 	mMaterial.setDisplacementMap(displacementMap);
@@ -77,9 +105,9 @@ void MeshPBR::setBrdfLUT(std::shared_ptr<Texture> brdfLUT)
 	mBrdfLUT = brdfLUT;
 }
 
-void MeshPBR::setIrradianceMap(std::shared_ptr<CubeMap> irradianceMap)
+void MeshPBR::setIrradianceSH(std::shared_ptr<SphericalHarmonics> irradianceSH)
 {
-	mIrradianceMap = irradianceMap;
+	mIrradianceSH = irradianceSH;
 }
 
 void MeshPBR::setPreFilterMap(std::shared_ptr<CubeMap> preFilterMap)
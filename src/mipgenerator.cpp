@@ -0,0 +1,377 @@
+#include "mipgenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "parallel.h"
+#include "simd.h"
+
+namespace {
+	const float PI = 3.14159265359f;
+	const float KAISER_ALPHA = 4.0f;
+	const float WINDOWED_SUPPORT = 3.0f;
+
+	// Output rows filtered together, the horizontally filtered source rows they share are computed once
+	const int ROW_BLOCK = 32;
+
+	float sinc(float x)
+	{
+		if (std::abs(x) < 1e-6f) {
+			return 1.0f;
+		}
+
+		x *= PI;
+		return std::sin(x) / x;
+	}
+
+	// Zeroth order modified Bessel function of the first kind
+	float besselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+
+		for (int k = 1; k < 32; ++k) {
+			term *= (x / (2.0f * k)) * (x / (2.0f * k));
+			sum += term;
+
+			if (term < sum * 1e-7f) {
+				break;
+			}
+		}
+
+		return sum;
+	}
+
+	float filterSupport(MipGenerator::Filter filter)
+	{
+		return filter == MipGenerator::BOX ? 0.5f : WINDOWED_SUPPORT;
+	}
+
+	// Kernel weight at x, in destination texels
+	float filterWeight(MipGenerator::Filter filter, float x)
+	{
+		float t = std::abs(x) / WINDOWED_SUPPORT;
+
+		switch (filter) {
+		case MipGenerator::BOX:
+			return std::abs(x) <= 0.5f ? 1.0f : 0.0f;
+		case MipGenerator::KAISER:
+			return t < 1.0f ? sinc(x) * besselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / besselI0(KAISER_ALPHA) : 0.0f;
+		case MipGenerator::LANCZOS:
+			return t < 1.0f ? sinc(x) * sinc(t) : 0.0f;
+		default:
+			return 0.0f;
+		}
+	}
+
+	// Normalized weights of a 1D resampling, every output texel uses the same number of taps
+	struct Taps
+	{
+		int count = 0;
+		std::vector<int> first;
+		std::vector<float> weights;
+	};
+
+	Taps buildTaps(int sourceSize, int size, MipGenerator::Filter filter)
+	{
+		Taps taps;
+		float scale = static_cast<float>(sourceSize) / size;
+		float support = filterSupport(filter) * scale;
+		taps.count = static_cast<int>(std::ceil(2.0f * support)) + 1;
+		taps.first.resize(size);
+		taps.weights.resize(static_cast<size_t>(size) * taps.count);
+
+		for (int i = 0; i < size; ++i) {
+			float center = (i + 0.5f) * scale;
+			int first = static_cast<int>(std::floor(center - support));
+			float* weights = taps.weights.data() + static_cast<size_t>(i) * taps.count;
+			float sum = 0.0f;
+
+			for (int t = 0; t < taps.count; ++t) {
+				weights[t] = filterWeight(filter, (first + t + 0.5f - center) / scale);
+				sum += weights[t];
+			}
+
+			for (int t = 0; t < taps.count; ++t) {
+				weights[t] /= sum;
+			}
+
+			taps.first[i] = first;
+		}
+
+		return taps;
+	}
+
+	int wrap(int i, int size)
+	{
+		return ((i % size) + size) % size;
+	}
+
+	// Unorm texel values to linear float and back, round to nearest in the encoded space
+	struct Encoding
+	{
+		std::vector<float> decode;
+		std::vector<float> midpoints; // sRGB only, 8 bits
+		float maxValue;
+
+		Encoding(bool srgb, bool wide) : maxValue(wide ? 65535.0f : 255.0f)
+		{
+			decode.resize(static_cast<size_t>(maxValue) + 1);
+
+			for (size_t i = 0; i < decode.size(); ++i) {
+				decode[i] = srgb ? toLinear(i / maxValue) : i / maxValue;
+			}
+
+			if (srgb) {
+				midpoints.resize(255);
+
+				for (int i = 0; i < 255; ++i) {
+					midpoints[i] = toLinear((i + 0.5f) / 255.0f);
+				}
+			}
+		}
+
+		unsigned int encode(float value) const
+		{
+			if (!midpoints.empty()) {
+				return static_cast<unsigned int>(std::upper_bound(midpoints.begin(), midpoints.end(), value) - midpoints.begin());
+			}
+
+			return static_cast<unsigned int>(std::min(std::max(value, 0.0f), 1.0f) * maxValue + 0.5f);
+		}
+
+		static float toLinear(float value)
+		{
+			return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+	};
+
+	struct Layout
+	{
+		int channels = 4;
+		bool wide = false; // 16 bits per channel
+		const Encoding* encodings[4] = {};
+
+		size_t texelSize() const
+		{
+			return static_cast<size_t>(channels) * (wide ? 2 : 1);
+		}
+	};
+
+	void decodeRow(const char* texels, int width, const Layout& layout, float* row)
+	{
+		for (int i = 0; i < width * layout.channels; ++i) {
+			unsigned int value = layout.wide ? reinterpret_cast<const uint16_t*>(texels)[i] : static_cast<unsigned char>(texels[i]);
+			row[i] = layout.encodings[i % layout.channels]->decode[value];
+		}
+	}
+
+	// Negative lobes can overshoot, the encodings clamp
+	void encodeRow(const float* row, int width, const Layout& layout, char* texels)
+	{
+		for (int i = 0; i < width * layout.channels; ++i) {
+			unsigned int value = layout.encodings[i % layout.channels]->encode(row[i]);
+
+			if (layout.wide) {
+				reinterpret_cast<uint16_t*>(texels)[i] = static_cast<uint16_t>(value);
+			}
+			else {
+				texels[i] = static_cast<char>(value);
+			}
+		}
+	}
+
+	// output += weight * input, over count floats
+	void accumulate(float* output, const float* input, float weight, int count)
+	{
+		int i = 0;
+
+#ifdef PBR_SSE2
+		__m128 w = _mm_set1_ps(weight);
+
+		for (; i + 4 <= count; i += 4) {
+			_mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(w, _mm_loadu_ps(input + i))));
+		}
+#endif
+
+		for (; i < count; ++i) {
+			output[i] += weight * input[i];
+		}
+	}
+
+	// Filters the output texels [begin, end) of a row, output starts at begin
+	void filterRow(const float* row, int sourceWidth, const Taps& taps, int begin, int end, int channels, float* output)
+	{
+		output -= static_cast<size_t>(begin) * channels;
+
+		for (int x = begin; x < end; ++x) {
+			const float* weights = taps.weights.data() + static_cast<size_t>(x) * taps.count;
+			int first = taps.first[x];
+
+#ifdef PBR_SSE2
+			if (channels == 4) {
+				__m128 sum = _mm_setzero_ps();
+
+				for (int t = 0; t < taps.count; ++t) {
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(row + wrap(first + t, sourceWidth) * 4)));
+				}
+
+				_mm_storeu_ps(output + x * 4, sum);
+				continue;
+			}
+#endif
+
+			float sum[4] = {};
+
+			for (int t = 0; t < taps.count; ++t) {
+				const float* texel = row + wrap(first + t, sourceWidth) * channels;
+
+				for (int c = 0; c < channels; ++c) {
+					sum[c] += weights[t] * texel[c];
+				}
+			}
+
+			memcpy(output + x * channels, sum, channels * sizeof(float));
+		}
+	}
+
+	// Filters the texels of region in a level of the given width
+	void downsample(const char* source, int sourceWidth, int sourceHeight, char* level, int width,
+		const MipGenerator::Region& region, const Taps& horizontal, const Taps& vertical, const Layout& layout)
+	{
+		int channels = layout.channels;
+		int regionWidth = region.width;
+
+		parallelFor(region.height, [&](size_t begin, size_t end) {
+			std::vector<float> decoded(static_cast<size_t>(sourceWidth) * channels);
+			std::vector<float> filtered;
+			std::vector<float> output(static_cast<size_t>(regionWidth) * channels);
+			int rowsEnd = region.y + static_cast<int>(end);
+
+			for (int blockBegin = region.y + static_cast<int>(begin); blockBegin < rowsEnd; blockBegin += ROW_BLOCK) {
+				int blockEnd = std::min(blockBegin + ROW_BLOCK, rowsEnd);
+
+				// Source rows used by the block, before wrapping
+				int firstRow = vertical.first[blockBegin];
+				int rowCount = vertical.first[blockEnd - 1] + vertical.count - firstRow;
+				filtered.resize(static_cast<size_t>(rowCount) * regionWidth * channels);
+
+				for (int r = 0; r < rowCount; ++r) {
+					decodeRow(source + static_cast<size_t>(wrap(firstRow + r, sourceHeight)) * sourceWidth * layout.texelSize(), sourceWidth, layout, decoded.data());
+					filterRow(decoded.data(), sourceWidth, horizontal, region.x, region.x + regionWidth, channels, filtered.data() + static_cast<size_t>(r) * regionWidth * channels);
+				}
+
+				for (int y = blockBegin; y < blockEnd; ++y) {
+					const float* weights = vertical.weights.data() + static_cast<size_t>(y) * vertical.count;
+					std::fill(output.begin(), output.end(), 0.0f);
+
+					for (int t = 0; t < vertical.count; ++t) {
+						accumulate(output.data(), filtered.data() + static_cast<size_t>(vertical.first[y] + t - firstRow) * regionWidth * channels, weights[t], regionWidth * channels);
+					}
+
+					encodeRow(output.data(), regionWidth, layout, level + (static_cast<size_t>(y) * width + region.x) * layout.texelSize());
+				}
+			}
+		});
+	}
+
+	// Output texels whose taps read the source texels [begin, end). Taps wrapping around an edge
+	// make the range span the whole level.
+	void affectedRange(const Taps& taps, int sourceSize, int size, int begin, int end, int& outputBegin, int& outputEnd)
+	{
+		outputBegin = size;
+		outputEnd = 0;
+
+		for (int i = 0; i < size; ++i) {
+			for (int t = 0; t < taps.count; ++t) {
+				int source = wrap(taps.first[i] + t, sourceSize);
+
+				if (source >= begin && source < end) {
+					outputBegin = std::min(outputBegin, i);
+					outputEnd = std::max(outputEnd, i + 1);
+					break;
+				}
+			}
+		}
+	}
+
+	// Refilters region of level 0 down the chain, each level from the previous one
+	std::vector<MipGenerator::Region> refilter(TextureLevels& levels, MipGenerator::Region region, MipGenerator::Filter filter)
+	{
+		bool srgb = levels.internalFormat == GL_SRGB8_ALPHA8;
+		Layout layout;
+		layout.wide = levels.type == GL_UNSIGNED_SHORT;
+		layout.channels = static_cast<int>(levels.bytesPerPixel) / (layout.wide ? 2 : 1);
+
+		Encoding linear(false, layout.wide);
+		Encoding color(srgb, layout.wide);
+
+		for (int c = 0; c < layout.channels; ++c) {
+			layout.encodings[c] = c < 3 ? &color : &linear;
+		}
+
+		std::vector<MipGenerator::Region> regions(levels.mipLevels);
+		regions[0] = region;
+
+		for (int mip = 1; mip < levels.mipLevels && !region.isEmpty(); ++mip) {
+			int sourceWidth = std::max(1, levels.width >> (mip - 1));
+			int sourceHeight = std::max(1, levels.height >> (mip - 1));
+			int levelWidth = std::max(1, levels.width >> mip);
+			int levelHeight = std::max(1, levels.height >> mip);
+
+			Taps horizontal = buildTaps(sourceWidth, levelWidth, filter);
+			Taps vertical = buildTaps(sourceHeight, levelHeight, filter);
+
+			int xBegin, xEnd, yBegin, yEnd;
+			affectedRange(horizontal, sourceWidth, levelWidth, region.x, region.x + region.width, xBegin, xEnd);
+			affectedRange(vertical, sourceHeight, levelHeight, region.y, region.y + region.height, yBegin, yEnd);
+
+			region.x = xBegin;
+			region.y = yBegin;
+			region.width = xEnd - xBegin;
+			region.height = yEnd - yBegin;
+			regions[mip] = region;
+
+			if (!region.isEmpty()) {
+				downsample(levels.faceData(mip - 1, 0), sourceWidth, sourceHeight, levels.faceData(mip, 0), levelWidth, region, horizontal, vertical, layout);
+			}
+		}
+
+		return regions;
+	}
+}
+
+int MipGenerator::mipLevelCount(int width, int height)
+{
+	int levels = 1;
+	while ((std::max(width, height) >> levels) > 0) {
+		levels++;
+	}
+
+	return levels;
+}
+
+TextureLevels MipGenerator::generate(const void* pixels, int width, int height, GLenum internalFormat, Filter filter)
+{
+	TextureLevels levels;
+	levels.setInternalFormat(internalFormat);
+	levels.width = width;
+	levels.height = height;
+	levels.faces = 1;
+	levels.mipLevels = mipLevelCount(width, height);
+	levels.data.resize(levels.totalSize());
+	memcpy(levels.faceData(0, 0), pixels, levels.levelSize(0));
+
+	Region region;
+	region.width = width;
+	region.height = height;
+	refilter(levels, region, filter);
+
+	return levels;
+}
+
+std::vector<MipGenerator::Region> MipGenerator::update(TextureLevels& levels, const Region& region, Filter filter)
+{
+	return refilter(levels, region, filter);
+}
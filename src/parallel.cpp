@@ -0,0 +1,174 @@
+#include "parallel.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+	// Ranges per thread, a few more than one balances ranges of uneven cost and nested calls
+	const size_t RANGES_PER_THREAD = 4;
+
+	thread_local bool insideRegion = false;
+
+	struct Job
+	{
+		const std::function<void(size_t begin, size_t end)>* body;
+		size_t count;
+		size_t rangeSize;
+		size_t rangeCount;
+		size_t nextRange = 0; // Both guarded by the pool mutex
+		size_t finishedRanges = 0;
+	};
+
+	class ThreadPool
+	{
+	public:
+		ThreadPool()
+		{
+			unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+			for (unsigned int i = 1; i < threadCount; ++i) {
+				mThreads.emplace_back(&ThreadPool::workerLoop, this);
+			}
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStopping = true;
+			}
+
+			mCondition.notify_all();
+
+			for (std::thread& thread : mThreads) {
+				thread.join();
+			}
+		}
+
+		size_t threadCount() const
+		{
+			return mThreads.size() + 1;
+		}
+
+		// Returns once every range of the job ran
+		void run(Job& job)
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJobs.push_back(&job);
+			mCondition.notify_all();
+
+			while (job.finishedRanges < job.rangeCount) {
+				// The job's own ranges first, then the queued ones so nested jobs can't stall
+				Job* next = job.nextRange < job.rangeCount ? &job : frontJob();
+
+				if (next) {
+					runRange(*next, lock);
+				}
+				else {
+					mCondition.wait(lock);
+				}
+			}
+		}
+
+	private:
+		std::vector<std::thread> mThreads;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		std::deque<Job*> mJobs;
+		bool mStopping = false;
+
+		// Oldest job with ranges left, jobs whose ranges are all taken leave the queue
+		Job* frontJob()
+		{
+			while (!mJobs.empty() && mJobs.front()->nextRange >= mJobs.front()->rangeCount) {
+				mJobs.pop_front();
+			}
+
+			return mJobs.empty() ? nullptr : mJobs.front();
+		}
+
+		// Ranges are taken and finished under the lock, the job can't be left before they're all done
+		void runRange(Job& job, std::unique_lock<std::mutex>& lock)
+		{
+			size_t range = job.nextRange++;
+			size_t begin = range * job.rangeSize;
+			size_t end = std::min(begin + job.rangeSize, job.count);
+
+			if (job.nextRange == job.rangeCount) {
+				mJobs.erase(std::remove(mJobs.begin(), mJobs.end(), &job), mJobs.end());
+			}
+
+			lock.unlock();
+			(*job.body)(begin, end);
+			lock.lock();
+
+			if (++job.finishedRanges == job.rangeCount) {
+				mCondition.notify_all();
+			}
+		}
+
+		void workerLoop()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+
+			for (;;) {
+				Job* job = frontJob();
+
+				if (job) {
+					runRange(*job, lock);
+				}
+				else if (mStopping) {
+					return;
+				}
+				else {
+					mCondition.wait(lock);
+				}
+			}
+		}
+	};
+
+	ThreadPool& threadPool()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+}
+
+void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body)
+{
+	if (count == 0) {
+		return;
+	}
+
+	if (count == 1 || insideRegion) {
+		body(0, count);
+		return;
+	}
+
+	ThreadPool& pool = threadPool();
+
+	if (pool.threadCount() == 1) {
+		body(0, count);
+		return;
+	}
+
+	Job job;
+	job.body = &body;
+	job.count = count;
+	job.rangeSize = (count + pool.threadCount() * RANGES_PER_THREAD - 1) / (pool.threadCount() * RANGES_PER_THREAD);
+	job.rangeCount = (count + job.rangeSize - 1) / job.rangeSize;
+	pool.run(job);
+}
+
+ParallelRegion::ParallelRegion() : mWasInside(insideRegion)
+{
+	insideRegion = true;
+}
+
+ParallelRegion::~ParallelRegion()
+{
+	insideRegion = mWasInside;
+}
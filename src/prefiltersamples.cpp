@@ -0,0 +1,87 @@
+#include "prefiltersamples.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const float PI = 3.14159265359f;
+
+	// efficient Van Der Corput calculation.
+	float radicalInverseVdC(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(bits) * 2.3283064365386963e-10f; // / 0x100000000
+	}
+
+	float distributionGGX(float NdotH, float roughness)
+	{
+		float a = roughness * roughness;
+		float a2 = a * a;
+		float denom = (NdotH * NdotH * (a2 - 1.0f) + 1.0f);
+		return a2 / (PI * denom * denom);
+	}
+}
+
+unsigned int PrefilterSamples::sampleCount(unsigned int mip)
+{
+	// Rougher mips are smaller but their lobes are wider, so they get more samples
+	const unsigned int counts[] = { 0, 64, 128, 256, 512 };
+	return counts[std::min(mip, 4u)];
+}
+
+PrefilterSamples::Table PrefilterSamples::generate(float roughness, unsigned int sampleCount, int envRes)
+{
+	Table table;
+	sampleCount = std::min(sampleCount, MAX_SAMPLES);
+	table.samples.reserve(sampleCount);
+
+	float a = roughness * roughness;
+	float saTexel = 4.0f * PI / (6.0f * envRes * envRes);
+
+	for (unsigned int i = 0; i < sampleCount; ++i) {
+		float xiX = static_cast<float>(i) / sampleCount;
+		float xiY = radicalInverseVdC(i);
+		float phi = 2.0f * PI * xiX;
+		float cosTheta = std::sqrt((1.0f - xiY) / (1.0f + (a * a - 1.0f) * xiY));
+		float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+		glm::vec3 H(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+		glm::vec3 L = 2.0f * H.z * H - glm::vec3(0.0f, 0.0f, 1.0f);
+
+		if (L.z <= 0.0f) {
+			continue;
+		}
+
+		// sample from the environment's mip level based on roughness/pdf, HdotV == NdotH here
+		float pdf = distributionGGX(H.z, roughness) / 4.0f + 0.0001f;
+		float saSample = 1.0f / (sampleCount * pdf + 0.0001f);
+		float mipLevel = roughness == 0.0f ? 0.0f : std::max(0.5f * std::log2(saSample / saTexel), 0.0f);
+
+		table.samples.push_back(glm::vec4(glm::normalize(L), mipLevel));
+		table.totalWeight += L.z;
+	}
+
+	return table;
+}
+
+std::vector<PrefilterSamples::Table> PrefilterSamples::generateMips(int mipLevels, int envRes, int preFilterRes)
+{
+	std::vector<Table> tables;
+
+	// Mip 0 is a plain copy, a single sample from the environment mip of the same size
+	float copyLod = std::max(0.0f, std::log2(static_cast<float>(envRes) / preFilterRes));
+	Table copyTable;
+	copyTable.samples.push_back(glm::vec4(0.0f, 0.0f, 1.0f, copyLod));
+	copyTable.totalWeight = 1.0f;
+	tables.push_back(copyTable);
+
+	for (int mip = 1; mip < mipLevels; ++mip) {
+		float roughness = (float)mip / (float)(mipLevels - 1);
+		tables.push_back(generate(roughness, sampleCount(mip), envRes));
+	}
+
+	return tables;
+}
@@ -1,42 +1,20 @@
 #include <algorithm>
-#include <cmrc\cmrc.hpp>
-CMRC_DECLARE(resources);
+#include <filesystem>
 #include "shader.h"
+#include "assets.h"
+#include "sphericalharmonics.h"
+#include "uniformblocks.h"
 
 namespace {
 	void readFile(const GLchar* path, std::string& content)
 	{
-		std::ifstream shaderFile(path);
-		if (shaderFile.good()) {
-			shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-			try
-			{
-				// open files
-				shaderFile.open(path);
-				std::stringstream shaderStream;
-				// read file's buffer contents into streams
-				shaderStream << shaderFile.rdbuf();
-				// close file handlers
-				shaderFile.close();
-				// convert stream into string
-				content = shaderStream.str();
-			}
-			catch (std::ifstream::failure e)
-			{
-				std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ file: " << path << std::endl;
-			}
+		MappedFile shaderFile;
+
+		if (Assets::open(path, shaderFile)) {
+			content.assign(shaderFile.data(), shaderFile.size());
 		}
 		else {
-			// Fall back to embedded resources
-			auto fs = cmrc::resources::get_filesystem();
-			if (fs.exists(path)) {
-				auto shaderRes = fs.open(path);
-				content = std::string(shaderRes.cbegin(), shaderRes.size());
-			}
-			else {
-				std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ file: " << path << std::endl;
-			}
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ file: " << path << std::endl;
 		}
 	}
 
@@ -64,6 +42,54 @@ namespace {
 		}
 	}
 
+	// Replaces the #include "file" lines with the file, found next to the including shader
+	void addIncludes(std::string& code, const GLchar* path)
+	{
+		const std::string directive = "#include \"";
+		size_t position = 0;
+
+		while ((position = code.find(directive, position)) != std::string::npos) {
+			size_t nameEnd = code.find('"', position + directive.size());
+			size_t lineEnd = code.find('\n', position);
+
+			if (nameEnd == std::string::npos || nameEnd > lineEnd) {
+				position += directive.size();
+				continue;
+			}
+
+			std::string name = code.substr(position + directive.size(), nameEnd - position - directive.size());
+			std::string included;
+			readFile((std::filesystem::path(path).parent_path() / name).generic_string().c_str(), included);
+
+			lineEnd = lineEnd == std::string::npos ? code.size() : lineEnd;
+			code.replace(position, lineEnd - position, included);
+			position += included.size();
+		}
+	}
+
+	void addDefines(std::string& code, const std::vector<std::string>& defines)
+	{
+		std::string lines;
+		for (const std::string& define : defines) {
+			lines += "#define " + define + "\n";
+		}
+
+		// #version has to stay the first statement
+		size_t position = code.find("#version");
+		position = position == std::string::npos ? 0 : code.find('\n', position);
+		position = position == std::string::npos ? code.size() : position + 1;
+		code.insert(position, lines);
+	}
+
+	// Value of a name in a table sorted by hash, -1 if it's missing
+	GLint findEntry(const std::vector<std::pair<uint32_t, GLint>>& entries, UniformName name)
+	{
+		auto it = std::lower_bound(entries.begin(), entries.end(), name.getHash(),
+			[](const std::pair<uint32_t, GLint>& entry, uint32_t hash) { return entry.first < hash; });
+
+		return it != entries.end() && it->first == name.getHash() ? it->second : -1;
+	}
+
 	void compileShader(unsigned int& shaderId, const char* code, GLenum type) {
 		// vertex Shader
 		shaderId = glCreateShader(type);
@@ -73,7 +99,7 @@ namespace {
 	}
 }
 
-Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
+Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const std::vector<std::string>& defines)
 {
 	// shader Program
 	mID = glCreateProgram();
@@ -82,21 +108,39 @@ Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
 
 	std::string vertexCode;
 	readFile(vertexPath, vertexCode);
+	addIncludes(vertexCode, vertexPath);
+	addDefines(vertexCode, defines);
 	compileShader(vertex, vertexCode.c_str(), GL_VERTEX_SHADER);
 	glAttachShader(mID, vertex);
 
 	std::string fragmentCode;
 	readFile(fragmentPath, fragmentCode);
+	addIncludes(fragmentCode, fragmentPath);
+	addDefines(fragmentCode, defines);
 	compileShader(fragment, fragmentCode.c_str(), GL_FRAGMENT_SHADER);
 	glAttachShader(mID, fragment);
 
 	glLinkProgram(mID);
 	checkProgramCompileErrors(mID);
+	resolveUniforms();
+
+	// Blocks shared by every program keep the same binding points
+	setUniformBlock("IrradianceSH", SphericalHarmonics::BINDING_POINT);
+	setUniformBlock("FrameData", UniformBlocks::FRAME_BINDING_POINT);
+	setUniformBlock("ObjectData", UniformBlocks::OBJECT_BINDING_POINT);
+	setUniformBlock("MaterialData", UniformBlocks::MATERIAL_BINDING_POINT);
 	// delete the shaders as they're linked into our program now and no longer necessery
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
 }
 
+std::string Shader::readSource(const GLchar* path)
+{
+	std::string content;
+	readFile(path, content);
+	return content;
+}
+
 Shader::~Shader()
 {
 	release();
@@ -116,64 +160,126 @@ void Shader::release()
 {
 	glDeleteProgram(mID);
 	mID = 0;
+	mLocations.clear();
+	mBlockIndices.clear();
 }
 
-void Shader::setBool(const std::string &name, bool value) const
+void Shader::resolveUniforms()
 {
-	glUniform1i(glGetUniformLocation(mID, name.c_str()), (int)value);
+	GLint uniformCount = 0, blockCount = 0, maxNameLength = 0, maxBlockNameLength = 0;
+	glGetProgramiv(mID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(mID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	glGetProgramiv(mID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	glGetProgramiv(mID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+	std::vector<GLchar> name(std::max(std::max(maxNameLength, maxBlockNameLength), 1));
+
+	for (GLint i = 0; i < uniformCount; ++i) {
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(mID, i, static_cast<GLsizei>(name.size()), NULL, &size, &type, name.data());
+		GLint location = glGetUniformLocation(mID, name.data());
+
+		// Members of uniform blocks have no location
+		if (location < 0) {
+			continue;
+		}
+
+		// Arrays are reported by their first element, they're set through their plain name
+		std::string uniform = name.data();
+
+		if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0) {
+			uniform.resize(uniform.size() - 3);
+		}
+
+		mLocations.emplace_back(UniformName(uniform).getHash(), location);
+	}
+
+	for (GLint i = 0; i < blockCount; ++i) {
+		glGetActiveUniformBlockName(mID, i, static_cast<GLsizei>(name.size()), NULL, name.data());
+		mBlockIndices.emplace_back(UniformName(name.data()).getHash(), i);
+	}
+
+	for (std::vector<Entry>* entries : { &mLocations, &mBlockIndices }) {
+		std::sort(entries->begin(), entries->end());
+
+		auto collision = std::adjacent_find(entries->begin(), entries->end(), [](const Entry& a, const Entry& b) { return a.first == b.first; });
+
+		if (collision != entries->end()) {
+			std::cout << "ERROR::SHADER::UNIFORM_NAME_HASH_COLLISION hash: " << collision->first << std::endl;
+		}
+	}
 }
 
-void Shader::setInt(const std::string &name, int value) const
+GLint Shader::getLocation(UniformName name) const
 {
-	glUniform1i(glGetUniformLocation(mID, name.c_str()), value);
+	return findEntry(mLocations, name);
 }
 
-void Shader::setFloat(const std::string &name, float value) const
+void Shader::setBool(UniformName name, bool value) const
 {
-	glUniform1f(glGetUniformLocation(mID, name.c_str()), value);
+	glUniform1i(getLocation(name), (int)value);
 }
 
-void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
+void Shader::setInt(UniformName name, int value) const
 {
-	glUniform2fv(glGetUniformLocation(mID, name.c_str()), 1, &value[0]);
+	glUniform1i(getLocation(name), value);
 }
 
-void Shader::setVec2(const std::string &name, float x, float y) const
+void Shader::setFloat(UniformName name, float value) const
 {
-	glUniform2f(glGetUniformLocation(mID, name.c_str()), x, y);
+	glUniform1f(getLocation(name), value);
 }
 
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
+void Shader::setVec2(UniformName name, const glm::vec2 &value) const
 {
-	glUniform3fv(glGetUniformLocation(mID, name.c_str()), 1, &value[0]);
+	glUniform2fv(getLocation(name), 1, &value[0]);
 }
 
-void Shader::setVec3(const std::string &name, float x, float y, float z) const
+void Shader::setVec2(UniformName name, float x, float y) const
 {
-	glUniform3f(glGetUniformLocation(mID, name.c_str()), x, y, z);
+	glUniform2f(getLocation(name), x, y);
 }
 
-void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
+void Shader::setVec3(UniformName name, const glm::vec3 &value) const
 {
-	glUniform4fv(glGetUniformLocation(mID, name.c_str()), 1, &value[0]);
+	glUniform3fv(getLocation(name), 1, &value[0]);
 }
 
-void Shader::setVec4(const std::string &name, float x, float y, float z, float w) const
+void Shader::setVec3(UniformName name, float x, float y, float z) const
 {
-	glUniform4f(glGetUniformLocation(mID, name.c_str()), x, y, z, w);
+	glUniform3f(getLocation(name), x, y, z);
 }
 
-void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
+void Shader::setVec4(UniformName name, const glm::vec4 &value) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(mID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniform4fv(getLocation(name), 1, &value[0]);
 }
 
-void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
+void Shader::setVec4(UniformName name, float x, float y, float z, float w) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(mID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniform4f(getLocation(name), x, y, z, w);
 }
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
+void Shader::setMat2(UniformName name, const glm::mat2 &mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(mID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix2fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setMat3(UniformName name, const glm::mat3 &mat) const
+{
+	glUniformMatrix3fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setMat4(UniformName name, const glm::mat4 &mat) const
+{
+	glUniformMatrix4fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setUniformBlock(UniformName name, GLuint bindingPoint) const
+{
+	GLint blockIndex = findEntry(mBlockIndices, name);
+
+	if (blockIndex >= 0) {
+		glUniformBlockBinding(mID, static_cast<GLuint>(blockIndex), bindingPoint);
+	}
 }
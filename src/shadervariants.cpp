@@ -0,0 +1,17 @@
+#include "shadervariants.h"
+
+ShaderVariants::ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, const DefinesFunction& defines)
+	: mVertexPath(vertexPath), mFragmentPath(fragmentPath), mDefines(defines)
+{
+}
+
+const Shader& ShaderVariants::get(unsigned int variant)
+{
+	auto it = mVariants.find(variant);
+
+	if (it == mVariants.end()) {
+		it = mVariants.emplace(variant, std::make_unique<Shader>(mVertexPath.c_str(), mFragmentPath.c_str(), mDefines(variant))).first;
+	}
+
+	return *it->second;
+}
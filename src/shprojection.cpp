@@ -0,0 +1,180 @@
+#include "shprojection.h"
+#include "parallel.h"
+#include "simd.h"
+#include <mutex>
+
+namespace {
+	const float PI = 3.14159265359f;
+
+	// Radiance accumulated per basis function and channel, plus the total solid angle
+	struct Accumulator
+	{
+		float sums[9][3] = {};
+		float weight = 0.0f;
+
+		void add(const Accumulator& other)
+		{
+			for (int i = 0; i < 9; ++i) {
+				for (int c = 0; c < 3; ++c) {
+					sums[i][c] += other.sums[i][c];
+				}
+			}
+
+			weight += other.weight;
+		}
+	};
+
+	// Cubemap face basis for GL face order: direction = major + u * uAxis + v * vAxis
+	const glm::vec3 faceMajor[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	const glm::vec3 faceU[6] = { { 0, 0, -1 }, { 0, 0, 1 }, { 1, 0, 0 }, { 1, 0, 0 }, { 1, 0, 0 }, { -1, 0, 0 } };
+	const glm::vec3 faceV[6] = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+
+	void accumulateRowScalar(Accumulator& acc, const float* row, int face, float v, int faceRes, int firstTexel = 0)
+	{
+		for (int x = firstTexel; x < faceRes; ++x) {
+			float u = (2.0f * (x + 0.5f) / faceRes) - 1.0f;
+			glm::vec3 dir = faceMajor[face] + u * faceU[face] + v * faceV[face];
+			float invLength = 1.0f / glm::length(dir);
+			dir *= invLength;
+
+			// Texel solid angle is proportional to 1 / (1 + u^2 + v^2)^(3/2)
+			float weight = invLength * invLength * invLength;
+			float basis[9] = {
+				1.0f, dir.y, dir.z, dir.x,
+				dir.x * dir.y, dir.y * dir.z, 3.0f * dir.z * dir.z - 1.0f, dir.x * dir.z, dir.x * dir.x - dir.y * dir.y
+			};
+
+			const float* texel = row + 4 * x;
+			for (int i = 0; i < 9; ++i) {
+				for (int c = 0; c < 3; ++c) {
+					acc.sums[i][c] += texel[c] * basis[i] * weight;
+				}
+			}
+
+			acc.weight += weight;
+		}
+	}
+
+#ifdef PBR_SSE2
+	// Four texels per iteration. Every face direction is a permutation of (+-1, +-u, +-v)
+	// so the row only needs the u component vectorized.
+	void accumulateRowSSE(Accumulator& acc, const float* row, int face, float v, int faceRes)
+	{
+		__m128 sums[9][3];
+		for (int i = 0; i < 9; ++i) {
+			for (int c = 0; c < 3; ++c) {
+				sums[i][c] = _mm_setzero_ps();
+			}
+		}
+
+		__m128 weightSum = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 three = _mm_set1_ps(3.0f);
+		const float step = 2.0f / faceRes;
+		const glm::vec3 base = faceMajor[face] + v * faceV[face];
+		const glm::vec3 axis = faceU[face];
+		int x = 0;
+
+		for (; x + 4 <= faceRes; x += 4) {
+			__m128 u = _mm_set_ps((x + 3.5f) * step - 1.0f, (x + 2.5f) * step - 1.0f, (x + 1.5f) * step - 1.0f, (x + 0.5f) * step - 1.0f);
+			__m128 dx = _mm_add_ps(_mm_set1_ps(base.x), _mm_mul_ps(u, _mm_set1_ps(axis.x)));
+			__m128 dy = _mm_add_ps(_mm_set1_ps(base.y), _mm_mul_ps(u, _mm_set1_ps(axis.y)));
+			__m128 dz = _mm_add_ps(_mm_set1_ps(base.z), _mm_mul_ps(u, _mm_set1_ps(axis.z)));
+
+			__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			__m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+			dx = _mm_mul_ps(dx, invLength);
+			dy = _mm_mul_ps(dy, invLength);
+			dz = _mm_mul_ps(dz, invLength);
+			__m128 weight = _mm_mul_ps(invLength, _mm_mul_ps(invLength, invLength));
+
+			__m128 basis[9] = {
+				one, dy, dz, dx,
+				_mm_mul_ps(dx, dy), _mm_mul_ps(dy, dz), _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(dz, dz)), one),
+				_mm_mul_ps(dx, dz), _mm_sub_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))
+			};
+
+			// RGBA texels to per channel registers
+			__m128 t0 = _mm_loadu_ps(row + 4 * x);
+			__m128 t1 = _mm_loadu_ps(row + 4 * x + 4);
+			__m128 t2 = _mm_loadu_ps(row + 4 * x + 8);
+			__m128 t3 = _mm_loadu_ps(row + 4 * x + 12);
+			_MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+			__m128 channels[3] = { _mm_mul_ps(t0, weight), _mm_mul_ps(t1, weight), _mm_mul_ps(t2, weight) };
+
+			for (int i = 0; i < 9; ++i) {
+				for (int c = 0; c < 3; ++c) {
+					sums[i][c] = _mm_add_ps(sums[i][c], _mm_mul_ps(channels[c], basis[i]));
+				}
+			}
+
+			weightSum = _mm_add_ps(weightSum, weight);
+		}
+
+		alignas(16) float lanes[4];
+		for (int i = 0; i < 9; ++i) {
+			for (int c = 0; c < 3; ++c) {
+				_mm_store_ps(lanes, sums[i][c]);
+				acc.sums[i][c] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+			}
+		}
+
+		_mm_store_ps(lanes, weightSum);
+		acc.weight += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+		// Remaining texels
+		accumulateRowScalar(acc, row, face, v, faceRes, x);
+	}
+#endif
+}
+
+int SHProjection::sourceMip(int environmentResolution, int environmentMipLevels)
+{
+	int mip = 0;
+	while (mip + 1 < environmentMipLevels && (environmentResolution >> (mip + 1)) >= SOURCE_RESOLUTION) {
+		mip++;
+	}
+
+	return mip;
+}
+
+SHProjection::Coefficients SHProjection::projectCubeMap(const float* faces, int faceRes)
+{
+	Accumulator total;
+	std::mutex totalMutex;
+	size_t rowCount = static_cast<size_t>(6 * faceRes);
+
+	parallelFor(rowCount, [&](size_t begin, size_t end) {
+		Accumulator local;
+
+		for (size_t r = begin; r < end; ++r) {
+			int face = static_cast<int>(r) / faceRes;
+			int y = static_cast<int>(r) % faceRes;
+			float v = (2.0f * (y + 0.5f) / faceRes) - 1.0f;
+			const float* row = faces + 4 * static_cast<size_t>(faceRes) * r;
+#ifdef PBR_SSE2
+			accumulateRowSSE(local, row, face, v, faceRes);
+#else
+			accumulateRowScalar(local, row, face, v, faceRes);
+#endif
+		}
+
+		std::lock_guard<std::mutex> lock(totalMutex);
+		total.add(local);
+	});
+
+	// Normalize the accumulated weights to the full sphere, then apply the cosine lobe
+	// convolution (PI, 2PI/3, PI/4) and the basis constants. Dividing by PI matches the
+	// irradiance / PI convention used by shaderpbr.fs.
+	const float band[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+	const float basisConstant[9] = { 0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f };
+	float normalization = total.weight > 0.0f ? 4.0f * PI / total.weight : 0.0f;
+
+	Coefficients coefficients;
+	for (int i = 0; i < 9; ++i) {
+		float scale = normalization * band[i] * basisConstant[i] * basisConstant[i];
+		coefficients[i] = glm::vec3(total.sums[i][0], total.sums[i][1], total.sums[i][2]) * scale;
+	}
+
+	return coefficients;
+}
@@ -0,0 +1,50 @@
+#include "sphericalharmonics.h"
+
+SphericalHarmonics::SphericalHarmonics()
+{
+	glGenBuffers(1, &mID);
+	glBindBuffer(GL_UNIFORM_BUFFER, mID);
+	glBufferData(GL_UNIFORM_BUFFER, 9 * sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+SphericalHarmonics::~SphericalHarmonics()
+{
+	release();
+}
+
+GLuint SphericalHarmonics::getId() const
+{
+	return mID;
+}
+
+void SphericalHarmonics::bind(GLuint bindingPoint) const
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, mID);
+}
+
+void SphericalHarmonics::setCoefficients(const SHProjection::Coefficients& coefficients)
+{
+	mCoefficients = coefficients;
+
+	// std140 pads every array element to a vec4
+	glm::vec4 block[9];
+	for (int i = 0; i < 9; ++i) {
+		block[i] = glm::vec4(coefficients[i], 0.0f);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, mID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+const SHProjection::Coefficients& SphericalHarmonics::getCoefficients() const
+{
+	return mCoefficients;
+}
+
+void SphericalHarmonics::release()
+{
+	glDeleteBuffers(1, &mID);
+	mID = 0;
+}
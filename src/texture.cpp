@@ -1,21 +1,10 @@
 #include "texture.h"
-#include <stb_image.h>
-#include <iostream>
-#include <vector>
-#include <cmrc\cmrc.hpp>
-CMRC_DECLARE(resources);
 
 Texture::Texture()
 {
 	glGenTextures(1, &mID);
 }
 
-Texture::Texture(const GLchar* texturePath, bool srgb)
-{
-	glGenTextures(1, &mID);
-	loadTexture(texturePath, srgb);
-}
-
 Texture::~Texture()
 {
 	release();
@@ -32,44 +21,46 @@ void Texture::bind(GLenum textureUnit) const
 	glBindTexture(GL_TEXTURE_2D, mID);
 }
 
-void Texture::loadTexture(const GLchar* texturePath, bool srgb)
+void Texture::setConstant(bool constant, const glm::vec4& value)
 {
-	glBindTexture(GL_TEXTURE_2D, mID);
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	int width, height, nrChannels;
-	stbi_set_flip_vertically_on_load(false);
-	unsigned char *data = stbi_load(texturePath, &width, &height, &nrChannels, 4);
+	mConstant = constant;
+	mConstantValue = value;
+}
+
+bool Texture::isConstant() const
+{
+	return mConstant;
+}
+
+const glm::vec4& Texture::getConstantValue() const
+{
+	return mConstantValue;
+}
 
-	if (!data) {
-		// Fall back to embedded resources
-		auto fs = cmrc::resources::get_filesystem();
-		if (fs.exists(texturePath)) {
-			auto shaderRes = fs.open(texturePath);
-			std::string str(shaderRes.begin(), shaderRes.size());
-			data = stbi_load_from_memory((const unsigned char*)str.c_str(), str.size(), &width, &height, &nrChannels, 4);
-		}
-	}
+void Texture::setValueRange(const glm::vec4& minValue, const glm::vec4& maxValue)
+{
+	mMinValue = minValue;
+	mMaxValue = maxValue;
+}
 
-	if (data) {
-		GLenum format = GL_RGBA;
+const glm::vec4& Texture::getMinValue() const
+{
+	return mMinValue;
+}
 
-		if (srgb) {
-			format = GL_SRGB_ALPHA;
-		}
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else {
-		std::cout << "Failed to load texture" << std::endl;
-	}
+const glm::vec4& Texture::getMaxValue() const
+{
+	return mMaxValue;
+}
 
-	stbi_image_free(data);
+void Texture::setContentHash(uint64_t hash)
+{
+	mContentHash = hash;
+}
+
+uint64_t Texture::getContentHash() const
+{
+	return mContentHash;
 }
 
 void Texture::release()
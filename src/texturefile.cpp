@@ -0,0 +1,35 @@
+#include "texturefile.h"
+#include <vector>
+#include "files.h"
+
+bool TextureFile::isTextureFile(const std::string& path)
+{
+	return Files::hasExtension(path, EXTENSION);
+}
+
+bool TextureFile::map(const MappedFile& file, TextureLevels& levels)
+{
+	size_t blobSize;
+
+	if (!file.isOpen() || !levels.map(file.data(), file.size(), blobSize) || blobSize != file.size()) {
+		return false;
+	}
+
+	// The client layout comes from the file, it has to be the one the loader would pick
+	TextureLevels layout;
+	return levels.faces == 1 && levels.mipLevels > 0
+		&& layout.setInternalFormat(levels.internalFormat) && layout.format == levels.format && layout.type == levels.type
+		&& layout.bytesPerPixel == levels.bytesPerPixel;
+}
+
+bool TextureFile::write(const std::string& path, const TextureLevels& levels)
+{
+	if (levels.faces != 1) {
+		return false;
+	}
+
+	std::vector<char> data;
+	levels.serialize(data);
+
+	return Files::writeAtomic(path, data.data(), data.size());
+}
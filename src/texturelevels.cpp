@@ -0,0 +1,230 @@
+#include "texturelevels.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	const char BLOB_MAGIC[4] = { 'P', 'B', 'R', 'C' };
+	const uint32_t BLOB_VERSION = 1;
+
+	struct BlobHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t internalFormat;
+		uint32_t format;
+		uint32_t type;
+		uint32_t width;
+		uint32_t height;
+		uint32_t faces;
+		uint32_t mipLevels;
+		uint32_t bytesPerPixel;
+	};
+
+	// Larger than any GL texture, keeps the sizes of malformed headers from overflowing
+	const uint32_t MAX_SIZE = 1 << 16;
+	const uint32_t MAX_BYTES_PER_PIXEL = 16;
+
+	// Rejects headers whose sizes the level loops can't handle, before anything is computed from them
+	bool validHeader(const BlobHeader& header)
+	{
+		if (header.width == 0 || header.height == 0 || header.width > MAX_SIZE || header.height > MAX_SIZE
+			|| (header.faces != 1 && header.faces != 6) || header.bytesPerPixel == 0 || header.bytesPerPixel > MAX_BYTES_PER_PIXEL) {
+			return false;
+		}
+
+		// floor(log2(max(width, height))) + 1
+		uint32_t fullMipLevels = 0;
+
+		for (uint32_t size = std::max(header.width, header.height); size > 0; size >>= 1) {
+			fullMipLevels++;
+		}
+
+		return header.mipLevels > 0 && header.mipLevels <= fullMipLevels;
+	}
+}
+
+bool TextureLevels::setInternalFormat(GLint internalFormat)
+{
+	this->internalFormat = internalFormat;
+
+	switch (internalFormat) {
+	case GL_RGB16F:
+		format = GL_RGB;
+		type = GL_HALF_FLOAT;
+		bytesPerPixel = 6;
+		return true;
+	case GL_RG16F:
+		format = GL_RG;
+		type = GL_HALF_FLOAT;
+		bytesPerPixel = 4;
+		return true;
+	case GL_RGBA16F:
+		format = GL_RGBA;
+		type = GL_HALF_FLOAT;
+		bytesPerPixel = 8;
+		return true;
+	case GL_R11F_G11F_B10F:
+		format = GL_RGB;
+		type = GL_UNSIGNED_INT_10F_11F_11F_REV;
+		bytesPerPixel = 4;
+		return true;
+	case GL_RGB9_E5:
+		format = GL_RGB;
+		type = GL_UNSIGNED_INT_5_9_9_9_REV;
+		bytesPerPixel = 4;
+		return true;
+	case GL_R8:
+		format = GL_RED;
+		type = GL_UNSIGNED_BYTE;
+		bytesPerPixel = 1;
+		return true;
+	case GL_RG8:
+		format = GL_RG;
+		type = GL_UNSIGNED_BYTE;
+		bytesPerPixel = 2;
+		return true;
+	case GL_R16:
+		format = GL_RED;
+		type = GL_UNSIGNED_SHORT;
+		bytesPerPixel = 2;
+		return true;
+	case GL_RGBA8:
+	case GL_SRGB8_ALPHA8:
+		format = GL_RGBA;
+		type = GL_UNSIGNED_BYTE;
+		bytesPerPixel = 4;
+		return true;
+	case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB:
+	case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB:
+	case GL_COMPRESSED_RG_RGTC2:
+		format = 0;
+		type = 0;
+		bytesPerPixel = 16;
+		return true;
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RED_RGTC1:
+		format = 0;
+		type = 0;
+		bytesPerPixel = 8;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool TextureLevels::isCompressed() const
+{
+	return format == 0;
+}
+
+bool TextureLevels::isEmpty() const
+{
+	return data.empty() && !mapped;
+}
+
+size_t TextureLevels::levelSize(int mip) const
+{
+	size_t levelWidth = std::max(1, width >> mip);
+	size_t levelHeight = std::max(1, height >> mip);
+
+	if (isCompressed()) {
+		return ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * bytesPerPixel;
+	}
+
+	return levelWidth * levelHeight * bytesPerPixel;
+}
+
+size_t TextureLevels::totalSize() const
+{
+	size_t size = 0;
+	for (int mip = 0; mip < mipLevels; ++mip) {
+		size += levelSize(mip) * faces;
+	}
+
+	return size;
+}
+
+const char* TextureLevels::faceData(int mip, int face) const
+{
+	size_t offset = 0;
+	for (int i = 0; i < mip; ++i) {
+		offset += levelSize(i) * faces;
+	}
+
+	return (mapped ? mapped : data.data()) + offset + levelSize(mip) * face;
+}
+
+char* TextureLevels::faceData(int mip, int face)
+{
+	return const_cast<char*>(static_cast<const TextureLevels*>(this)->faceData(mip, face));
+}
+
+void TextureLevels::serialize(std::vector<char>& blob) const
+{
+	BlobHeader header;
+	memcpy(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC));
+	header.version = BLOB_VERSION;
+	header.internalFormat = internalFormat;
+	header.format = format;
+	header.type = type;
+	header.width = width;
+	header.height = height;
+	header.faces = faces;
+	header.mipLevels = mipLevels;
+	header.bytesPerPixel = bytesPerPixel;
+
+	size_t size = isEmpty() ? 0 : totalSize();
+	size_t offset = blob.size();
+	blob.resize(offset + sizeof(BlobHeader) + size);
+	memcpy(blob.data() + offset, &header, sizeof(BlobHeader));
+
+	if (size > 0) {
+		memcpy(blob.data() + offset + sizeof(BlobHeader), faceData(0, 0), size);
+	}
+}
+
+bool TextureLevels::deserialize(const char* blob, size_t size, size_t& blobSize)
+{
+	if (!map(blob, size, blobSize)) {
+		return false;
+	}
+
+	data.assign(mapped, mapped + (blobSize - sizeof(BlobHeader)));
+	mapped = nullptr;
+	return true;
+}
+
+bool TextureLevels::map(const char* blob, size_t size, size_t& blobSize)
+{
+	if (size < sizeof(BlobHeader)) {
+		return false;
+	}
+
+	BlobHeader header;
+	memcpy(&header, blob, sizeof(BlobHeader));
+
+	if (memcmp(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0 || header.version != BLOB_VERSION || !validHeader(header)) {
+		return false;
+	}
+
+	internalFormat = header.internalFormat;
+	format = header.format;
+	type = header.type;
+	width = header.width;
+	height = header.height;
+	faces = header.faces;
+	mipLevels = header.mipLevels;
+	bytesPerPixel = header.bytesPerPixel;
+
+	blobSize = sizeof(BlobHeader) + totalSize();
+
+	if (size < blobSize) {
+		return false;
+	}
+
+	data.clear();
+	mapped = blob + sizeof(BlobHeader);
+	return true;
+}
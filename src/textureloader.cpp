@@ -0,0 +1,1068 @@
+#include "textureloader.h"
+#include <stb_image.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "assets.h"
+#include "bcn.h"
+#include "channels.h"
+#include "hash.h"
+#include "parallel.h"
+#include "texturefile.h"
+
+namespace {
+	// Decoding is bound by I/O and stb_image, a few workers are enough
+	const unsigned int MAX_WORKERS = 4;
+	const size_t BAND_BYTES = 4 * 1024 * 1024;
+
+	// Bumped when the encoders change, stale cache entries are then never read again
+	const uint32_t COMPRESSION_VERSION = 2;
+
+	// Texels of a near-constant map are within this many 8-bit steps of each other on every
+	// channel, dithering doesn't keep a flat map from being detected
+	const int CONSTANT_TOLERANCE = 2;
+
+	// Textures are only shrunk once they hold more than this many levels the camera doesn't need,
+	// zooming back and forth doesn't reallocate them every time
+	const int DROP_SLACK = 1;
+
+	void setTextureParameters()
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	// Layout of the decoded levels, and of the texture when it isn't compressed
+	GLenum uncompressedFormat(TextureLoader::Usage usage)
+	{
+		switch (usage) {
+		case TextureLoader::COLOR:
+			return GL_SRGB8_ALPHA8;
+		case TextureLoader::NORMAL:
+			return GL_RG8;
+		case TextureLoader::HEIGHT:
+			return GL_R16;
+		case TextureLoader::PACKED:
+			return GL_RGBA8;
+		default:
+			return GL_R8;
+		}
+	}
+
+	// Needs the context, the extensions are only known once GLAD is loaded.
+	// Heights keep their 16 bits, BC4 would band the displacement.
+	GLenum compressedFormat(TextureLoader::Usage usage)
+	{
+		switch (usage) {
+		case TextureLoader::COLOR:
+			if (GLAD_GL_ARB_texture_compression_bptc) {
+				return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB;
+			}
+
+			return GLAD_GL_EXT_texture_compression_s3tc && GLAD_GL_EXT_texture_sRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : 0;
+		case TextureLoader::NORMAL:
+			return GL_COMPRESSED_RG_RGTC2;
+		case TextureLoader::SCALAR:
+			return GL_COMPRESSED_RED_RGTC1;
+		case TextureLoader::PACKED:
+			return GLAD_GL_ARB_texture_compression_bptc ? GL_COMPRESSED_RGBA_BPTC_UNORM_ARB : 0;
+		default:
+			return 0;
+		}
+	}
+
+	// The material preview shows the channels the one and two channel formats drop, the shaders
+	// only read the stored ones
+	void setSwizzle(GLenum internalFormat)
+	{
+		if (internalFormat == GL_COMPRESSED_RED_RGTC1 || internalFormat == GL_R8 || internalFormat == GL_R16) {
+			const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+		else if (internalFormat == GL_COMPRESSED_RG_RGTC2 || internalFormat == GL_RG8) {
+			const GLint swizzle[] = { GL_RED, GL_GREEN, GL_ONE, GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+	}
+
+	// Bilinear resampling of a single channel image into one channel of an RGBA image, wrapping
+	// around the edges like the GL_REPEAT material textures
+	void resampleChannel(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* rgba, int width, int height, int channel)
+	{
+		float scaleX = static_cast<float>(sourceWidth) / width;
+		float scaleY = static_cast<float>(sourceHeight) / height;
+
+		parallelFor(height, [&](size_t begin, size_t end) {
+			for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y) {
+				float sourceY = (y + 0.5f) * scaleY - 0.5f;
+				int y0 = static_cast<int>(std::floor(sourceY));
+				float fy = sourceY - y0;
+				const unsigned char* row0 = source + static_cast<size_t>((y0 % sourceHeight + sourceHeight) % sourceHeight) * sourceWidth;
+				const unsigned char* row1 = source + static_cast<size_t>(((y0 + 1) % sourceHeight + sourceHeight) % sourceHeight) * sourceWidth;
+				unsigned char* texels = rgba + static_cast<size_t>(y) * width * 4 + channel;
+
+				for (int x = 0; x < width; ++x) {
+					float sourceX = (x + 0.5f) * scaleX - 0.5f;
+					int x0 = static_cast<int>(std::floor(sourceX));
+					float fx = sourceX - x0;
+					int column0 = (x0 % sourceWidth + sourceWidth) % sourceWidth;
+					int column1 = ((x0 + 1) % sourceWidth + sourceWidth) % sourceWidth;
+
+					float top = row0[column0] + (row0[column1] - row0[column0]) * fx;
+					float bottom = row1[column0] + (row1[column1] - row1[column0]) * fx;
+					texels[x * 4] = static_cast<unsigned char>(top + (bottom - top) * fy + 0.5f);
+				}
+			}
+		});
+	}
+
+	// Luminance of each image in one channel, at the size of the largest image. Alpha is opaque.
+	bool packChannels(const std::vector<MappedFile>& files, std::vector<unsigned char>& rgba, int& width, int& height)
+	{
+		struct Channel
+		{
+			unsigned char* pixels = nullptr;
+			int width = 0;
+			int height = 0;
+		};
+
+		std::vector<Channel> channels(files.size());
+		bool decoded = true;
+		width = 1;
+		height = 1;
+
+		for (size_t i = 0; i < files.size(); ++i) {
+			int nrChannels;
+			channels[i].pixels = stbi_load_from_memory((const unsigned char*)files[i].data(), static_cast<int>(files[i].size()), &channels[i].width, &channels[i].height, &nrChannels, 1);
+			decoded = decoded && channels[i].pixels;
+			width = std::max(width, channels[i].width);
+			height = std::max(height, channels[i].height);
+		}
+
+		if (decoded) {
+			rgba.assign(static_cast<size_t>(width) * height * 4, 255);
+
+			for (size_t i = 0; i < channels.size(); ++i) {
+				resampleChannel(channels[i].pixels, channels[i].width, channels[i].height, rgba.data(), width, height, static_cast<int>(i));
+			}
+		}
+
+		for (const Channel& channel : channels) {
+			stbi_image_free(channel.pixels);
+		}
+
+		return decoded;
+	}
+
+	void texSubImage(const TextureLevels& levels, int level, int x, int y, int width, int height, size_t size, const void* data)
+	{
+		if (levels.isCompressed()) {
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, levels.internalFormat, static_cast<GLsizei>(size), data);
+		}
+		else {
+			glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, levels.format, levels.type, data);
+		}
+	}
+
+	// Bounding box of the texels that differ between two images of the same layout
+	MipGenerator::Region changedRegion(const uint8_t* previous, const uint8_t* current, int width, int height, size_t texelSize)
+	{
+		MipGenerator::Region region;
+		size_t rowSize = width * texelSize;
+		int xBegin = width;
+		int xEnd = 0;
+		int yBegin = height;
+		int yEnd = 0;
+
+		for (int y = 0; y < height; ++y) {
+			const uint8_t* previousRow = previous + y * rowSize;
+			const uint8_t* currentRow = current + y * rowSize;
+
+			if (memcmp(previousRow, currentRow, rowSize) == 0) {
+				continue;
+			}
+
+			size_t first = 0;
+			size_t last = rowSize;
+
+			while (previousRow[first] == currentRow[first]) {
+				first++;
+			}
+
+			while (previousRow[last - 1] == currentRow[last - 1]) {
+				last--;
+			}
+
+			xBegin = std::min(xBegin, static_cast<int>(first / texelSize));
+			xEnd = std::max(xEnd, static_cast<int>((last - 1) / texelSize) + 1);
+			yBegin = std::min(yBegin, y);
+			yEnd = y + 1;
+		}
+
+		if (xEnd > xBegin) {
+			region.x = xBegin;
+			region.y = yBegin;
+			region.width = xEnd - xBegin;
+			region.height = yEnd - yBegin;
+		}
+
+		return region;
+	}
+
+	std::vector<MipGenerator::Region> wholeLevels(const TextureLevels& levels)
+	{
+		std::vector<MipGenerator::Region> regions(levels.mipLevels);
+
+		for (int mip = 0; mip < levels.mipLevels; ++mip) {
+			regions[mip].width = std::max(1, levels.width >> mip);
+			regions[mip].height = std::max(1, levels.height >> mip);
+		}
+
+		return regions;
+	}
+
+	// Channel of a decoded texel as the shaders sample it, sRGB colors are linear once sampled
+	float sampledValue(int stored, int channel, const TextureLevels& layout)
+	{
+		float value = stored / (layout.type == GL_UNSIGNED_SHORT ? 65535.0f : 255.0f);
+
+		if (layout.internalFormat == GL_SRGB8_ALPHA8 && channel < 3) {
+			value = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		return value;
+	}
+
+	// Value of the first texel as the shaders sample it, if every texel is close enough to it
+	bool constantValue(const uint8_t* pixels, size_t texelCount, const TextureLevels& layout, glm::vec4& value)
+	{
+		bool wide = layout.type == GL_UNSIGNED_SHORT;
+		int channels = static_cast<int>(layout.bytesPerPixel) / (wide ? 2 : 1);
+		int tolerance = wide ? CONSTANT_TOLERANCE * 257 : CONSTANT_TOLERANCE;
+		const uint16_t* wideTexels = reinterpret_cast<const uint16_t*>(pixels);
+
+		auto texel = [&](size_t index, int channel) -> int {
+			return wide ? wideTexels[index * channels + channel] : pixels[index * channels + channel];
+		};
+
+		for (size_t index = 1; index < texelCount; ++index) {
+			for (int channel = 0; channel < channels; ++channel) {
+				if (std::abs(texel(index, channel) - texel(0, channel)) > tolerance) {
+					return false;
+				}
+			}
+		}
+
+		value = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+		for (int channel = 0; channel < channels; ++channel) {
+			value[channel] = sampledValue(texel(0, channel), channel, layout);
+		}
+
+		return true;
+	}
+
+	// Smallest and largest value of each channel as the shaders sample them
+	void valueRange(const uint8_t* pixels, size_t texelCount, const TextureLevels& layout, glm::vec4& minValue, glm::vec4& maxValue)
+	{
+		bool wide = layout.type == GL_UNSIGNED_SHORT;
+		int channels = static_cast<int>(layout.bytesPerPixel) / (wide ? 2 : 1);
+		const uint16_t* wideTexels = reinterpret_cast<const uint16_t*>(pixels);
+		int lowest[4] = { 65535, 65535, 65535, 65535 };
+		int highest[4] = { 0, 0, 0, 0 };
+
+		for (size_t index = 0; index < texelCount; ++index) {
+			for (int channel = 0; channel < channels; ++channel) {
+				int stored = wide ? wideTexels[index * channels + channel] : pixels[index * channels + channel];
+				lowest[channel] = std::min(lowest[channel], stored);
+				highest[channel] = std::max(highest[channel], stored);
+			}
+		}
+
+		minValue = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		maxValue = minValue;
+
+		for (int channel = 0; channel < channels; ++channel) {
+			minValue[channel] = sampledValue(lowest[channel], channel, layout);
+			maxValue[channel] = sampledValue(highest[channel], channel, layout);
+		}
+	}
+
+	// Storage for the levels [firstMip, mipLevels), level 0 of the texture is firstMip. Nothing is
+	// sampled until the base level is lowered onto an uploaded level.
+	std::unique_ptr<Texture> allocateTexture(const TextureLevels& levels, int firstMip)
+	{
+		std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+		texture->bind(GL_TEXTURE0);
+		setTextureParameters();
+		setSwizzle(levels.internalFormat);
+
+		int levelCount = levels.mipLevels - firstMip;
+		GLsizei width = std::max(1, levels.width >> firstMip);
+		GLsizei height = std::max(1, levels.height >> firstMip);
+
+		if (GLAD_GL_ARB_texture_storage) {
+			glTexStorage2D(GL_TEXTURE_2D, levelCount, levels.internalFormat, width, height);
+		}
+		else {
+			for (int level = 0; level < levelCount; ++level) {
+				GLsizei levelWidth = std::max(1, width >> level);
+				GLsizei levelHeight = std::max(1, height >> level);
+
+				if (levels.isCompressed()) {
+					glCompressedTexImage2D(GL_TEXTURE_2D, level, levels.internalFormat, levelWidth, levelHeight, 0, static_cast<GLsizei>(levels.levelSize(firstMip + level)), nullptr);
+				}
+				else {
+					glTexImage2D(GL_TEXTURE_2D, level, levels.internalFormat, levelWidth, levelHeight, 0, levels.format, levels.type, nullptr);
+				}
+			}
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levelCount - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+		return texture;
+	}
+}
+
+TextureLoader::TextureLoader()
+{
+	glGenBuffers(1, &mPixelBuffer);
+
+	unsigned int workerCount = std::max(1u, std::min(MAX_WORKERS, std::thread::hardware_concurrency()));
+
+	for (unsigned int i = 0; i < workerCount; ++i) {
+		mWorkers.emplace_back(&TextureLoader::workerLoop, this);
+	}
+}
+
+TextureLoader::~TextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+
+	mCondition.notify_all();
+
+	for (std::thread& worker : mWorkers) {
+		worker.join();
+	}
+
+	glDeleteBuffers(1, &mPixelBuffer);
+}
+
+std::shared_ptr<Texture> TextureLoader::load(const std::string& texturePath, Usage usage, const glm::u8vec4& placeholder)
+{
+	return enqueue({ texturePath }, usage, placeholder);
+}
+
+std::shared_ptr<Texture> TextureLoader::loadPacked(const std::string& redPath, const std::string& greenPath, const std::string& bluePath, const glm::u8vec4& placeholder)
+{
+	return enqueue({ redPath, greenPath, bluePath }, PACKED, placeholder);
+}
+
+bool TextureLoader::reload(const std::shared_ptr<Texture>& texture)
+{
+	for (const std::shared_ptr<Job>& job : mStreamed) {
+		if (job->texture.lock() != texture) {
+			continue;
+		}
+
+		if (job->reloading) {
+			job->reloadAgain = true;
+		}
+		else {
+			queueReload(job);
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+void TextureLoader::queueReload(const std::shared_ptr<Job>& job)
+{
+	std::shared_ptr<Reload> reload = std::make_shared<Reload>();
+	reload->job = job;
+	job->reloading = true;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		mTasks.push_back([this, reload]() {
+			decodeChanges(*reload);
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			mReloaded.push_back(reload);
+		});
+	}
+
+	mCondition.notify_one();
+}
+
+std::shared_ptr<Texture> TextureLoader::enqueue(const std::vector<std::string>& texturePaths, Usage usage, const glm::u8vec4& placeholder)
+{
+	GLenum format = usage == COLOR ? GL_SRGB_ALPHA : GL_RGBA;
+
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+	texture->bind(GL_TEXTURE0);
+	setTextureParameters();
+	glTexImage2D(GL_TEXTURE_2D, 0, format, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, glm::value_ptr(placeholder));
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->texture = texture;
+	job->paths = texturePaths;
+	job->usage = usage;
+	job->internalFormat = uncompressedFormat(usage);
+	job->compression = compressedFormat(usage);
+	job->filter = mMipFilter;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending++;
+
+		mTasks.push_back([this, job]() {
+			decode(*job);
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			mDecoded.push_back(job);
+		});
+	}
+
+	mCondition.notify_one();
+
+	return texture;
+}
+
+void TextureLoader::update(size_t byteBudget)
+{
+	std::deque<std::shared_ptr<Reload>> reloaded;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		while (!mDecoded.empty()) {
+			std::shared_ptr<Job> job = std::move(mDecoded.front());
+			mDecoded.pop_front();
+
+			job->allocatedMip = job->levels.mipLevels;
+			job->residentMip = job->levels.mipLevels;
+
+			if (std::shared_ptr<Texture> texture = job->texture.lock()) {
+				texture->setConstant(job->constant, job->constantValue);
+				texture->setValueRange(job->minValue, job->maxValue);
+				texture->setContentHash(job->contentHash);
+			}
+
+			mStreamed.push_back(std::move(job));
+		}
+
+		std::swap(reloaded, mReloaded);
+	}
+
+	for (const std::shared_ptr<Reload>& reload : reloaded) {
+		Job& job = *reload->job;
+		job.reloading = false;
+
+		if (job.texture.expired()) {
+			continue;
+		}
+
+		// Also when nothing changed, the files may differ in more than their texels
+		if (!reload->failed) {
+			job.texture.lock()->setContentHash(reload->contentHash);
+		}
+
+		if (!reload->levels.isEmpty()) {
+			std::shared_ptr<Texture> texture = job.texture.lock();
+			texture->setConstant(reload->constant, reload->constantValue);
+			texture->setValueRange(reload->minValue, reload->maxValue);
+			applyReload(job, *reload);
+		}
+		else if (reload->failed) {
+			for (const std::string& path : job.paths) {
+				std::cout << "Failed to reload texture " << path << std::endl;
+			}
+		}
+
+		if (job.reloadAgain) {
+			job.reloadAgain = false;
+			queueReload(reload->job);
+		}
+	}
+
+	// Released textures are dropped, even before their upload
+	mStreamed.erase(std::remove_if(mStreamed.begin(), mStreamed.end(), [this](const std::shared_ptr<Job>& job) {
+		std::shared_ptr<Texture> texture = job->texture.lock();
+
+		if (texture && !job->levels.isEmpty()) {
+			return false;
+		}
+
+		if (texture) {
+			for (const std::string& path : job->paths) {
+				std::cout << "Failed to load texture " << path << std::endl;
+			}
+		}
+
+		if (!job->shown) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			mPending--;
+		}
+
+		return true;
+	}), mStreamed.end());
+
+	for (const std::shared_ptr<Job>& job : mStreamed) {
+		updateResidency(*job);
+	}
+
+	size_t uploaded = 0;
+
+	while (uploaded < byteBudget) {
+		// Coarse levels first, a new texture shows up before the others get sharper
+		Job* next = nullptr;
+
+		for (const std::shared_ptr<Job>& job : mStreamed) {
+			if (pendingMip(*job) >= 0 && (!next || pendingMip(*job) > pendingMip(*next))) {
+				next = job.get();
+			}
+		}
+
+		if (!next) {
+			break;
+		}
+
+		uploaded += uploadBand(*next);
+	}
+}
+
+bool TextureLoader::isLoading() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPending > 0;
+}
+
+void TextureLoader::setMipFilter(MipGenerator::Filter filter)
+{
+	mMipFilter = filter;
+}
+
+void TextureLoader::setPixelsPerUv(const glm::vec2& pixelsPerUv)
+{
+	mPixelsPerUv = pixelsPerUv;
+}
+
+size_t TextureLoader::getResidentBytes() const
+{
+	size_t size = 0;
+
+	for (const std::shared_ptr<Job>& job : mStreamed) {
+		for (int mip = job->allocatedMip; mip < job->levels.mipLevels; ++mip) {
+			size += job->levels.levelSize(mip);
+		}
+
+		for (int mip = job->staging ? job->stagingAllocatedMip : job->levels.mipLevels; mip < job->levels.mipLevels; ++mip) {
+			size += job->levels.levelSize(mip);
+		}
+	}
+
+	return size;
+}
+
+uint64_t TextureLoader::contentHash(const std::vector<MappedFile>& imageFiles)
+{
+	uint64_t hash = Hash::FNV_OFFSET;
+
+	for (const MappedFile& imageFile : imageFiles) {
+		hash = Hash::fnv1a(imageFile.data(), imageFile.size(), hash);
+	}
+
+	return hash;
+}
+
+// Chained after the content hash, the files are only read once
+std::string TextureLoader::cacheKey(uint64_t contentHash, GLenum compression, MipGenerator::Filter filter)
+{
+	const uint32_t values[] = { COMPRESSION_VERSION, compression, static_cast<uint32_t>(filter) };
+	return Hash::toHex(Hash::fnv1a(values, sizeof(values), contentHash));
+}
+
+bool TextureLoader::decodePixels(const std::vector<MappedFile>& files, Usage usage, GLenum internalFormat, std::vector<uint8_t>& pixels, int& width, int& height)
+{
+	int nrChannels;
+	void* decoded = nullptr;
+	std::vector<unsigned char> packed;
+
+	// Heights are read with their full precision, 8-bit files are widened by stb_image.
+	// A single PACKED file is already packed.
+	if (usage == HEIGHT) {
+		decoded = stbi_load_16_from_memory((const unsigned char*)files[0].data(), static_cast<int>(files[0].size()), &width, &height, &nrChannels, 1);
+	}
+	else if (files.size() == 1) {
+		decoded = stbi_load_from_memory((const unsigned char*)files[0].data(), static_cast<int>(files[0].size()), &width, &height, &nrChannels, 4);
+	}
+	else if (packChannels(files, packed, width, height)) {
+		decoded = packed.data();
+	}
+
+	if (!decoded) {
+		return false;
+	}
+
+	// Normals and scalar maps only keep the channels their format stores
+	TextureLevels layout;
+	layout.setInternalFormat(internalFormat);
+	size_t texelCount = static_cast<size_t>(width) * height;
+	pixels.resize(texelCount * layout.bytesPerPixel);
+
+	if (layout.type == GL_UNSIGNED_BYTE && layout.bytesPerPixel < 4) {
+		Channels::extract(static_cast<const uint8_t*>(decoded), texelCount, static_cast<int>(layout.bytesPerPixel), pixels.data());
+	}
+	else {
+		memcpy(pixels.data(), decoded, pixels.size());
+	}
+
+	if (packed.empty()) {
+		stbi_image_free(decoded);
+	}
+
+	return true;
+}
+
+void TextureLoader::decode(Job& job) const
+{
+	// Already in their final format, whatever the usage
+	if (job.paths.size() == 1 && TextureFile::isTextureFile(job.paths[0])) {
+		if (!Assets::open(job.paths[0], job.mapped)) {
+			return;
+		}
+
+		job.contentHash = Hash::fnv1a(job.mapped.data(), job.mapped.size());
+
+		if (!TextureFile::map(job.mapped, job.levels) || job.levels.faces != 1 || !BakeCache::supportsFormat(job.levels.internalFormat)) {
+			job.levels = TextureLevels();
+		}
+
+		return;
+	}
+
+	std::vector<MappedFile> files(job.paths.size());
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (!Assets::open(job.paths[i], files[i])) {
+			return;
+		}
+	}
+
+	job.contentHash = contentHash(files);
+	std::string key;
+
+	if (job.compression) {
+		key = cacheKey(job.contentHash, job.compression, job.filter);
+
+		if (mBakeCache.mapLevels(key, job.mapped, job.levels)) {
+			// Constant maps are cached as their single uncompressed texel
+			job.constant = job.levels.internalFormat == static_cast<GLint>(job.internalFormat) && job.levels.width == 1 && job.levels.height == 1
+				&& constantValue(reinterpret_cast<const uint8_t*>(job.levels.faceData(0, 0)), 1, job.levels, job.constantValue);
+
+			if (job.constant) {
+				job.minValue = job.constantValue;
+				job.maxValue = job.constantValue;
+				return;
+			}
+
+			if (job.levels.internalFormat == static_cast<GLint>(job.compression)) {
+				// Kept next to the levels, the range stays unknown without it
+				std::vector<char> range;
+
+				if (mBakeCache.loadData(key + ".range", range) && range.size() == 2 * sizeof(glm::vec4)) {
+					memcpy(glm::value_ptr(job.minValue), range.data(), sizeof(glm::vec4));
+					memcpy(glm::value_ptr(job.maxValue), range.data() + sizeof(glm::vec4), sizeof(glm::vec4));
+				}
+
+				return;
+			}
+		}
+
+		job.mapped.close();
+	}
+
+	int width, height;
+	std::vector<uint8_t> pixels;
+
+	if (!decodePixels(files, job.usage, job.internalFormat, pixels, width, height)) {
+		job.levels = TextureLevels();
+		return;
+	}
+
+	// Constant maps are kept as their first texel, materials read the value instead of sampling them
+	TextureLevels layout;
+	layout.setInternalFormat(job.internalFormat);
+	job.constant = constantValue(pixels.data(), static_cast<size_t>(width) * height, layout, job.constantValue);
+	valueRange(pixels.data(), static_cast<size_t>(width) * height, layout, job.minValue, job.maxValue);
+
+	if (job.constant) {
+		job.levels = MipGenerator::generate(pixels.data(), 1, 1, job.internalFormat, job.filter);
+
+		if (job.compression) {
+			mBakeCache.writeLevels(key, job.levels);
+			mBakeCache.evict();
+		}
+
+		return;
+	}
+
+	job.levels = MipGenerator::generate(pixels.data(), width, height, job.internalFormat, job.filter);
+
+	TextureLevels compressed;
+
+	if (job.compression && BCn::compressLevels(job.levels, job.compression, compressed)) {
+		const glm::vec4 range[] = { job.minValue, job.maxValue };
+		job.levels = std::move(compressed);
+		mBakeCache.writeLevels(key, job.levels);
+		mBakeCache.storeData(key + ".range", range, sizeof(range));
+		mBakeCache.evict();
+	}
+}
+
+void TextureLoader::decodeChanges(Reload& reload) const
+{
+	Job& job = *reload.job;
+
+	// GPU-ready files replace every level, copied since the texture may still upload from the old mapping
+	if (job.paths.size() == 1 && TextureFile::isTextureFile(job.paths[0])) {
+		MappedFile file;
+
+		if (!Assets::open(job.paths[0], file)) {
+			reload.failed = true;
+			return;
+		}
+
+		reload.contentHash = Hash::fnv1a(file.data(), file.size());
+
+		if (!TextureFile::map(file, reload.levels) || reload.levels.faces != 1 || !BakeCache::supportsFormat(reload.levels.internalFormat)) {
+			reload.levels = TextureLevels();
+			reload.failed = true;
+			return;
+		}
+
+		reload.levels.data.assign(reload.levels.faceData(0, 0), reload.levels.faceData(0, 0) + reload.levels.totalSize());
+		reload.levels.mapped = nullptr;
+		reload.regions = wholeLevels(reload.levels);
+		reload.resized = true;
+		return;
+	}
+
+	std::vector<MappedFile> files(job.paths.size());
+	int width, height;
+	std::vector<uint8_t> pixels;
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		reload.failed = reload.failed || !Assets::open(job.paths[i], files[i]);
+	}
+
+	if (reload.failed) {
+		return;
+	}
+
+	reload.contentHash = contentHash(files);
+
+	if (!decodePixels(files, job.usage, job.internalFormat, pixels, width, height)) {
+		reload.failed = true;
+		return;
+	}
+
+	TextureLevels layout;
+	layout.setInternalFormat(job.internalFormat);
+	reload.constant = constantValue(pixels.data(), static_cast<size_t>(width) * height, layout, reload.constantValue);
+	valueRange(pixels.data(), static_cast<size_t>(width) * height, layout, reload.minValue, reload.maxValue);
+
+	// Replaces the texture like a resize, the next reload has nothing to compare with
+	if (reload.constant) {
+		job.sourceLevels = TextureLevels();
+		reload.levels = MipGenerator::generate(pixels.data(), 1, 1, job.internalFormat, job.filter);
+		reload.regions = wholeLevels(reload.levels);
+		reload.resized = true;
+
+		if (job.compression) {
+			mBakeCache.writeLevels(cacheKey(reload.contentHash, job.compression, job.filter), reload.levels);
+			mBakeCache.evict();
+		}
+
+		return;
+	}
+
+	TextureLevels& source = job.sourceLevels;
+	reload.resized = source.isEmpty() || source.width != width || source.height != height;
+
+	// The first reload has nothing to compare with, every level is filtered and encoded again
+	if (reload.resized) {
+		source = MipGenerator::generate(pixels.data(), width, height, job.internalFormat, job.filter);
+		reload.regions = wholeLevels(source);
+	}
+	else {
+		MipGenerator::Region region = changedRegion(reinterpret_cast<const uint8_t*>(source.faceData(0, 0)), pixels.data(), width, height, source.bytesPerPixel);
+
+		if (region.isEmpty()) {
+			return;
+		}
+
+		size_t rowSize = static_cast<size_t>(width) * source.bytesPerPixel;
+
+		for (int y = region.y; y < region.y + region.height; ++y) {
+			size_t offset = y * rowSize + region.x * source.bytesPerPixel;
+			memcpy(source.faceData(0, 0) + offset, pixels.data() + offset, region.width * source.bytesPerPixel);
+		}
+
+		reload.regions = MipGenerator::update(source, region, job.filter);
+	}
+
+	if (!job.compression) {
+		reload.levels = source;
+		return;
+	}
+
+	// Only the blocks covering the changed texels are encoded, the others are copied
+	if (reload.resized || job.levels.internalFormat != static_cast<GLint>(job.compression)) {
+		BCn::compressLevels(source, job.compression, reload.levels);
+		reload.resized = true;
+	}
+	else {
+		reload.levels = job.levels;
+		reload.levels.data.assign(job.levels.faceData(0, 0), job.levels.faceData(0, 0) + job.levels.totalSize());
+		reload.levels.mapped = nullptr;
+
+		for (int mip = 0; mip < source.mipLevels; ++mip) {
+			const MipGenerator::Region& region = reload.regions[mip];
+
+			if (!region.isEmpty()) {
+				BCn::compressRegion(source, mip, region.x, region.y, region.width, region.height, reload.levels);
+			}
+		}
+	}
+
+	std::string key = cacheKey(reload.contentHash, job.compression, job.filter);
+	const glm::vec4 range[] = { reload.minValue, reload.maxValue };
+	mBakeCache.writeLevels(key, reload.levels);
+	mBakeCache.storeData(key + ".range", range, sizeof(range));
+	mBakeCache.evict();
+}
+
+void TextureLoader::workerLoop()
+{
+	// Textures are decoded side by side, their kernels run inline instead of on the shared pool
+	ParallelRegion region;
+
+	for (;;) {
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+
+			if (mStopping) {
+				return;
+			}
+
+			task = std::move(mTasks.front());
+			mTasks.pop_front();
+		}
+
+		task();
+	}
+}
+
+int TextureLoader::wantedMip(const TextureLevels& levels) const
+{
+	// Finest level whose texels aren't smaller than the pixels, trilinear filtering never reads finer
+	float texelsPerPixel = std::max(levels.width / mPixelsPerUv.x, levels.height / mPixelsPerUv.y);
+	float lod = std::log2(std::max(texelsPerPixel, 1.0f));
+
+	return static_cast<int>(std::min(lod, static_cast<float>(levels.mipLevels - 1)));
+}
+
+void TextureLoader::updateResidency(Job& job) const
+{
+	job.wantedMip = wantedMip(job.levels);
+
+	// Levels that are allocated are simply uploaded in place
+	if (!job.restage && job.wantedMip >= job.allocatedMip && job.wantedMip <= job.allocatedMip + DROP_SLACK) {
+		if (job.staging) {
+			job.staging = nullptr;
+			job.uploadedRows = 0;
+		}
+
+		return;
+	}
+
+	// A staging texture reaching coarser levels than needed is kept, it is shrunk once swapped
+	if (!job.staging || job.wantedMip < job.stagingAllocatedMip) {
+		job.staging = allocateTexture(job.levels, job.wantedMip);
+		job.stagingAllocatedMip = job.wantedMip;
+		job.stagingResidentMip = job.levels.mipLevels;
+		job.uploadedRows = 0;
+	}
+}
+
+int TextureLoader::pendingMip(const Job& job)
+{
+	if (job.staging) {
+		return job.stagingResidentMip - 1;
+	}
+
+	return !job.restage && job.residentMip > std::max(job.wantedMip, job.allocatedMip) ? job.residentMip - 1 : -1;
+}
+
+size_t TextureLoader::uploadBand(Job& job)
+{
+	const TextureLevels& levels = job.levels;
+	std::shared_ptr<Texture> texture = job.texture.lock();
+	Texture& target = job.staging ? *job.staging : *texture;
+	int allocatedMip = job.staging ? job.stagingAllocatedMip : job.allocatedMip;
+	int& residentMip = job.staging ? job.stagingResidentMip : job.residentMip;
+	int mip = residentMip - 1;
+
+	// Compressed levels are uploaded in rows of blocks, uploadedRows counts stored rows
+	int rowHeight = levels.isCompressed() ? 4 : 1;
+	int width = std::max(1, levels.width >> mip);
+	int height = std::max(1, levels.height >> mip);
+	int storedRows = (height + rowHeight - 1) / rowHeight;
+	size_t rowSize = levels.levelSize(mip) / storedRows;
+	int rows = static_cast<int>(std::min(std::max(BAND_BYTES / rowSize, size_t(1)), static_cast<size_t>(storedRows - job.uploadedRows)));
+	size_t size = rowSize * rows;
+	const char* band = levels.faceData(mip, 0) + rowSize * job.uploadedRows;
+	int y = job.uploadedRows * rowHeight;
+	int bandHeight = std::min(rows * rowHeight, height - y);
+
+	target.bind(GL_TEXTURE0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+
+	// One and two channel rows aren't padded to 4 bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// Orphaned every band, the previous one may still be read by the GPU
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	if (mapped) {
+		memcpy(mapped, band, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		texSubImage(levels, mip - allocatedMip, 0, y, width, bandHeight, size, nullptr);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	else {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		texSubImage(levels, mip - allocatedMip, 0, y, width, bandHeight, size, band);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	job.uploadedRows += rows;
+
+	if (job.uploadedRows < storedRows) {
+		return size;
+	}
+
+	// The completed level can be sampled
+	job.uploadedRows = 0;
+	residentMip = mip;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, mip - allocatedMip);
+
+	// A restaged texture only shows complete levels of the new content
+	int swapMip = job.restage ? job.stagingAllocatedMip : std::max(job.residentMip, job.stagingAllocatedMip);
+
+	if (job.staging && job.stagingResidentMip <= swapMip) {
+		if (!job.shown) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			mPending--;
+		}
+
+		*texture = std::move(*job.staging);
+		job.staging = nullptr;
+		job.allocatedMip = job.stagingAllocatedMip;
+		job.residentMip = job.stagingResidentMip;
+		job.shown = true;
+		job.restage = false;
+	}
+
+	return size;
+}
+
+void TextureLoader::applyReload(Job& job, Reload& reload)
+{
+	bool resized = reload.resized && (reload.levels.width != job.levels.width || reload.levels.height != job.levels.height
+		|| reload.levels.internalFormat != job.levels.internalFormat || reload.levels.mipLevels != job.levels.mipLevels);
+
+	job.levels = std::move(reload.levels);
+	job.mapped.close();
+
+	// Levels being uploaded start over with the new texels
+	job.staging = nullptr;
+	job.uploadedRows = 0;
+
+	// Still showing the placeholder, the upload starts over
+	if (!job.shown) {
+		job.allocatedMip = job.levels.mipLevels;
+		job.residentMip = job.levels.mipLevels;
+		return;
+	}
+
+	// The current texture stays until a new one holding the new size is uploaded
+	if (resized) {
+		job.restage = true;
+		return;
+	}
+
+	std::shared_ptr<Texture> texture = job.texture.lock();
+	texture->bind(GL_TEXTURE0);
+
+	for (int mip = job.residentMip; mip < job.levels.mipLevels; ++mip) {
+		if (!reload.regions[mip].isEmpty()) {
+			uploadRegion(job.levels, mip, mip - job.allocatedMip, reload.regions[mip]);
+		}
+	}
+}
+
+void TextureLoader::uploadRegion(const TextureLevels& levels, int mip, int level, const MipGenerator::Region& region)
+{
+	// Compressed regions are widened to whole blocks
+	int blockSize = levels.isCompressed() ? 4 : 1;
+	int levelWidth = std::max(1, levels.width >> mip);
+	int levelHeight = std::max(1, levels.height >> mip);
+	int x = region.x / blockSize * blockSize;
+	int y = region.y / blockSize * blockSize;
+	int width = std::min((region.x + region.width + blockSize - 1) / blockSize * blockSize, levelWidth) - x;
+	int height = std::min((region.y + region.height + blockSize - 1) / blockSize * blockSize, levelHeight) - y;
+
+	size_t rowSize = levels.levelSize(mip) / ((levelHeight + blockSize - 1) / blockSize);
+	size_t regionRowSize = levels.bytesPerPixel * ((width + blockSize - 1) / blockSize);
+	int rows = (height + blockSize - 1) / blockSize;
+	size_t size = regionRowSize * rows;
+	const char* texels = levels.faceData(mip, 0) + (y / blockSize) * rowSize + (x / blockSize) * levels.bytesPerPixel;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	char* mapped = static_cast<char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+	// Rows of the region are packed together
+	if (mapped) {
+		for (int row = 0; row < rows; ++row) {
+			memcpy(mapped + row * regionRowSize, texels + row * rowSize, regionRowSize);
+		}
+
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		texSubImage(levels, level, x, y, width, height, size, nullptr);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -0,0 +1,277 @@
+#include "textureregistry.h"
+#include <algorithm>
+#include <filesystem>
+#include <utility>
+#include <vector>
+#include "assets.h"
+#include "hash.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+	const char* USAGE_NAMES[] = { ".color", ".normal", ".scalar", ".height", ".packed" };
+}
+
+TextureRegistry::TextureRegistry(TextureLoader& loader, size_t unusedCapacity) : mLoader(loader), mUnusedCapacity(unusedCapacity)
+{
+}
+
+std::shared_ptr<Texture> TextureRegistry::acquire(const std::string& texturePath, TextureLoader::Usage usage, const glm::u8vec4& placeholder)
+{
+	Entry entry;
+	entry.paths = { texturePath };
+	entry.usage = usage;
+	std::string key;
+
+	// Missing files go straight to the loader, which reports the failure
+	if (!versionKey(entry.paths, usage, key)) {
+		mMisses++;
+		return mLoader.load(texturePath, usage, placeholder);
+	}
+
+	std::shared_ptr<Texture> texture = find(key);
+
+	if (texture) {
+		return texture;
+	}
+
+	entry.texture = mLoader.load(texturePath, usage, placeholder);
+	return insert(key, entry);
+}
+
+std::shared_ptr<Texture> TextureRegistry::acquirePacked(const std::string& redPath, const std::string& greenPath, const std::string& bluePath, const glm::u8vec4& placeholder)
+{
+	Entry entry;
+	entry.paths = { redPath, greenPath, bluePath };
+	entry.usage = TextureLoader::PACKED;
+	std::string key;
+
+	if (!versionKey(entry.paths, TextureLoader::PACKED, key)) {
+		mMisses++;
+		return mLoader.loadPacked(redPath, greenPath, bluePath, placeholder);
+	}
+
+	std::shared_ptr<Texture> texture = find(key);
+
+	if (texture) {
+		return texture;
+	}
+
+	entry.texture = mLoader.loadPacked(redPath, greenPath, bluePath, placeholder);
+	return insert(key, entry);
+}
+
+void TextureRegistry::update()
+{
+	mClock++;
+
+	// Textures only referenced by the registry are unused, the oldest go first
+	mUnused.clear();
+
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+		uint64_t contentHash = it->second.texture->getContentHash();
+
+		if (contentHash != 0 && contentHash != it->second.contentHash) {
+			mChanged.push_back(it);
+		}
+
+		if (it->second.texture.use_count() > 1) {
+			it->second.lastUse = mClock;
+		}
+		else {
+			mUnused.emplace_back(it->second.lastUse, it);
+		}
+	}
+
+	// Rekeying invalidates the iterators, the eviction waits for the next update
+	if (!mChanged.empty()) {
+		rekey();
+		return;
+	}
+
+	if (mUnused.size() <= mUnusedCapacity) {
+		return;
+	}
+
+	std::sort(mUnused.begin(), mUnused.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	// Erasing an entry leaves the iterators of the others valid
+	for (size_t i = 0; i < mUnused.size() - mUnusedCapacity; ++i) {
+		forgetVersions(mUnused[i].second->first);
+		mEntries.erase(mUnused[i].second);
+	}
+
+	mUnused.clear();
+	mRevision++;
+}
+
+void TextureRegistry::reload(const std::string& texturePath)
+{
+	// The entries keep their key until the loader set the new content hash, see update(). The
+	// current version of the files leads to them in the meantime. A failed reload leaves them as
+	// they are.
+	for (auto& item : mEntries) {
+		const Entry& entry = item.second;
+		std::string version;
+
+		if (std::find(entry.paths.begin(), entry.paths.end(), texturePath) != entry.paths.end()
+			&& mLoader.reload(entry.texture) && versionKey(entry.paths, entry.usage, version)) {
+			mVersions[version] = item.first;
+		}
+	}
+}
+
+std::vector<std::string> TextureRegistry::getPaths() const
+{
+	std::vector<std::string> paths;
+
+	for (const auto& item : mEntries) {
+		for (const std::string& path : item.second.paths) {
+			if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+				paths.push_back(path);
+			}
+		}
+	}
+
+	return paths;
+}
+
+uint64_t TextureRegistry::getRevision() const
+{
+	return mRevision;
+}
+
+unsigned int TextureRegistry::getHits() const
+{
+	return mHits;
+}
+
+unsigned int TextureRegistry::getMisses() const
+{
+	return mMisses;
+}
+
+size_t TextureRegistry::getResidentCount() const
+{
+	return mEntries.size();
+}
+
+std::shared_ptr<Texture> TextureRegistry::find(const std::string& version)
+{
+	auto key = mVersions.find(version);
+
+	if (key == mVersions.end()) {
+		return nullptr;
+	}
+
+	auto it = mEntries.find(key->second);
+
+	if (it == mEntries.end()) {
+		return nullptr;
+	}
+
+	mHits++;
+	it->second.lastUse = mClock;
+
+	return it->second.texture;
+}
+
+// Keyed by the file version until the content hash comes in
+std::shared_ptr<Texture> TextureRegistry::insert(const std::string& version, const Entry& entry)
+{
+	mMisses++;
+
+	Entry& inserted = mEntries[version];
+	inserted = entry;
+	inserted.lastUse = mClock;
+	mVersions[version] = version;
+	mRevision++;
+
+	return inserted.texture;
+}
+
+void TextureRegistry::rekey()
+{
+	// Extracted first, inserting may rehash and invalidate the other iterators
+	for (Entries::iterator it : mChanged) {
+		mRekeyed.push_back(mEntries.extract(it));
+	}
+
+	mChanged.clear();
+
+	for (Entries::node_type& node : mRekeyed) {
+		Entry& entry = node.mapped();
+		entry.contentHash = entry.texture->getContentHash();
+		std::string key = contentKey(entry.contentHash, entry.usage);
+		std::string version;
+
+		// Only the current version of the files leads to the new content, another file with the
+		// old content gets a texture of its own
+		forgetVersions(node.key());
+
+		if (versionKey(entry.paths, entry.usage, version)) {
+			mVersions[version] = key;
+		}
+
+		// A texture already loaded with the content stays the shared one, this one is released by
+		// the registry and freed with its last user
+		auto existing = mEntries.find(key);
+
+		if (existing != mEntries.end()) {
+			existing->second.lastUse = mClock;
+		}
+		else {
+			node.key() = key;
+			mEntries.insert(std::move(node));
+		}
+	}
+
+	mRekeyed.clear();
+	mRevision++;
+}
+
+void TextureRegistry::forgetVersions(const std::string& key)
+{
+	for (auto it = mVersions.begin(); it != mVersions.end();) {
+		if (it->second == key) {
+			it = mVersions.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+// One path, modification time and size per file. Embedded resources never change, they keep a
+// zero time and size.
+bool TextureRegistry::versionKey(const std::vector<std::string>& texturePaths, TextureLoader::Usage usage, std::string& key)
+{
+	key.clear();
+
+	for (const std::string& path : texturePaths) {
+		std::error_code error;
+		int64_t modificationTime = fs::last_write_time(path, error).time_since_epoch().count();
+		uintmax_t size = error ? 0 : fs::file_size(path, error);
+
+		if (error) {
+			MappedFile file;
+
+			if (!Assets::open(path, file)) {
+				return false;
+			}
+
+			modificationTime = 0;
+			size = 0;
+		}
+
+		key += path + '|' + std::to_string(modificationTime) + '|' + std::to_string(size) + '|';
+	}
+
+	key += USAGE_NAMES[usage];
+	return true;
+}
+
+std::string TextureRegistry::contentKey(uint64_t contentHash, TextureLoader::Usage usage)
+{
+	return Hash::toHex(contentHash) + USAGE_NAMES[usage];
+}
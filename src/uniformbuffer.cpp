@@ -0,0 +1,61 @@
+#include "uniformbuffer.h"
+#include <cstring>
+
+UniformBuffer::UniformBuffer(size_t size) : mContents(size)
+{
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	release();
+}
+
+GLuint UniformBuffer::getId() const
+{
+	return mID;
+}
+
+void UniformBuffer::bind(GLuint bindingPoint) const
+{
+	if (mID != 0) {
+		glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, mID);
+	}
+}
+
+bool UniformBuffer::update(const void* data)
+{
+	if (mID != 0 && std::memcmp(mContents.data(), data, mContents.size()) == 0) {
+		return false;
+	}
+
+	std::memcpy(mContents.data(), data, mContents.size());
+
+	if (mID == 0) {
+		glGenBuffers(1, &mID);
+		glBindBuffer(GL_UNIFORM_BUFFER, mID);
+		glBufferData(GL_UNIFORM_BUFFER, mContents.size(), nullptr, GL_DYNAMIC_DRAW);
+	}
+	else {
+		glBindBuffer(GL_UNIFORM_BUFFER, mID);
+	}
+
+	// The previous contents are orphaned rather than waited on if a draw still reads them
+	void* mapped = glMapBufferRange(GL_UNIFORM_BUFFER, 0, mContents.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	if (mapped) {
+		std::memcpy(mapped, mContents.data(), mContents.size());
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+	else {
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, mContents.size(), mContents.data());
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	return true;
+}
+
+void UniformBuffer::release()
+{
+	glDeleteBuffers(1, &mID);
+	mID = 0;
+}
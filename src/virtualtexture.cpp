@@ -0,0 +1,389 @@
+#include "virtualtexture.h"
+#include <algorithm>
+#include <iostream>
+#include "assets.h"
+#include "bakecache.h"
+
+namespace {
+	const int CACHE_PAGES = 16; // Per side of the physical cache
+	const size_t MAX_QUEUED_TILES = 256;
+
+	int tileMip(uint64_t id)
+	{
+		return static_cast<int>(id >> 40);
+	}
+
+	int tileY(uint64_t id)
+	{
+		return static_cast<int>((id >> 20) & 0xFFFFF);
+	}
+
+	int tileX(uint64_t id)
+	{
+		return static_cast<int>(id & 0xFFFFF);
+	}
+}
+
+VirtualTexture::VirtualTexture()
+{
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	close();
+}
+
+bool VirtualTexture::open(const std::string& path)
+{
+	close();
+
+	if (!Assets::open(path, mFile) || !VirtualTextureFile::read(mFile.data(), mFile.size(), mInfo) || !BakeCache::supportsFormat(mInfo.internalFormat)) {
+		std::cout << "Failed to load virtual texture " << path << std::endl;
+		close();
+		return false;
+	}
+
+	int coarsest = mInfo.mipLevels - 1;
+
+	if (mInfo.tilesX(coarsest) * mInfo.tilesY(coarsest) >= CACHE_PAGES * CACHE_PAGES) {
+		std::cout << "Virtual texture " << path << " is too elongated for the tile cache" << std::endl;
+		close();
+		return false;
+	}
+
+	TextureLevels layout;
+	layout.setInternalFormat(mInfo.internalFormat);
+	layout.width = CACHE_PAGES * VirtualTextureFile::PAGE_SIZE;
+	layout.height = layout.width;
+
+	// Sampled at level 0 only, the tile borders cover the bilinear footprint
+	glGenTextures(1, &mCache);
+	glBindTexture(GL_TEXTURE_2D, mCache);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	if (layout.isCompressed()) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, mInfo.internalFormat, layout.width, layout.height, 0, static_cast<GLsizei>(layout.levelSize(0)), nullptr);
+	}
+	else {
+		glTexImage2D(GL_TEXTURE_2D, 0, mInfo.internalFormat, layout.width, layout.height, 0, layout.format, layout.type, nullptr);
+	}
+
+	glGenTextures(1, &mPageTable);
+	glBindTexture(GL_TEXTURE_2D, mPageTable);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mInfo.mipLevels - 1);
+	mPageTableLevels.resize(mInfo.mipLevels);
+
+	for (int mip = 0; mip < mInfo.mipLevels; ++mip) {
+		mPageTableLevels[mip].assign(static_cast<size_t>(mInfo.tilesX(mip)) * mInfo.tilesY(mip) * 4, 0);
+		glTexImage2D(GL_TEXTURE_2D, mip, GL_RGBA8, mInfo.tilesX(mip), mInfo.tilesY(mip), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+
+	mPages.resize(CACHE_PAGES * CACHE_PAGES);
+
+	// The fallback of every other tile
+	for (int y = 0; y < mInfo.tilesY(coarsest); ++y) {
+		for (int x = 0; x < mInfo.tilesX(coarsest); ++x) {
+			Tile tile;
+			tile.id = tileId(coarsest, x, y);
+			loadTile(tile.id, tile.data);
+			uploadTile(tile, true);
+		}
+	}
+
+	refreshPageTable();
+
+	mStopping = false;
+	mWorker = std::thread(&VirtualTexture::workerLoop, this);
+
+	return true;
+}
+
+void VirtualTexture::requestTiles(const std::vector<uint16_t>& feedback)
+{
+	if (!mCache) {
+		return;
+	}
+
+	mFrame++;
+	std::unordered_set<uint64_t> visible;
+
+	for (size_t i = 0; i + 3 < feedback.size(); i += 4) {
+		int x = feedback[i];
+		int y = feedback[i + 1];
+		int mip = feedback[i + 2];
+
+		if (feedback[i + 3] == 0 || mip >= mInfo.mipLevels || x >= mInfo.tilesX(mip) || y >= mInfo.tilesY(mip)) {
+			continue;
+		}
+
+		// The ancestors are read by trilinear filtering and shown while the tile loads
+		for (; mip < mInfo.mipLevels; ++mip, x /= 2, y /= 2) {
+			if (!visible.insert(tileId(mip, x, y)).second) {
+				break;
+			}
+		}
+	}
+
+	std::vector<uint64_t> missing;
+
+	for (uint64_t id : visible) {
+		auto resident = mResident.find(id);
+
+		if (resident != mResident.end()) {
+			mPages[resident->second].lastUsed = mFrame;
+		}
+		else if (mRequested.count(id) == 0) {
+			missing.push_back(id);
+		}
+	}
+
+	// Coarse tiles first, they cover the most pixels
+	std::sort(missing.begin(), missing.end(), [](uint64_t a, uint64_t b) {
+		return tileMip(a) > tileMip(b);
+	});
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// Queued tiles that went out of view are dropped
+		std::deque<uint64_t> queue;
+
+		for (uint64_t id : mQueue) {
+			if (visible.count(id) != 0) {
+				queue.push_back(id);
+			}
+			else {
+				mRequested.erase(id);
+			}
+		}
+
+		for (uint64_t id : missing) {
+			if (queue.size() >= MAX_QUEUED_TILES) {
+				break;
+			}
+
+			queue.push_back(id);
+			mRequested.insert(id);
+		}
+
+		mQueue = std::move(queue);
+	}
+
+	mCondition.notify_one();
+}
+
+void VirtualTexture::update(int maxTiles)
+{
+	std::vector<Tile> tiles;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		while (!mLoaded.empty() && static_cast<int>(tiles.size()) < maxTiles) {
+			tiles.push_back(std::move(mLoaded.front()));
+			mLoaded.pop_front();
+		}
+	}
+
+	for (const Tile& tile : tiles) {
+		mRequested.erase(tile.id);
+		uploadTile(tile, false);
+	}
+
+	if (mPageTableDirty) {
+		refreshPageTable();
+	}
+}
+
+void VirtualTexture::bind(const Shader& shader, UniformName name, unsigned int& textureUnit) const
+{
+	shader.setInt(name + "PageTable", textureUnit);
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_2D, mPageTable);
+	textureUnit++;
+
+	shader.setInt(name + "Cache", textureUnit);
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_2D, mCache);
+	textureUnit++;
+
+	shader.setVec4(name + "Virtual", getParameters());
+}
+
+glm::vec4 VirtualTexture::getParameters() const
+{
+	return glm::vec4(mInfo.width, mInfo.height, mInfo.mipLevels, CACHE_PAGES);
+}
+
+GLuint VirtualTexture::getCacheId() const
+{
+	return mCache;
+}
+
+size_t VirtualTexture::getResidentCount() const
+{
+	return mResident.size();
+}
+
+std::vector<std::string> VirtualTexture::shaderDefines()
+{
+	return {
+		"VIRTUAL_TILE_SIZE " + std::to_string(VirtualTextureFile::TILE_SIZE) + ".0",
+		"VIRTUAL_TILE_BORDER " + std::to_string(VirtualTextureFile::TILE_BORDER) + ".0",
+		"VIRTUAL_PAGE_SIZE " + std::to_string(VirtualTextureFile::PAGE_SIZE) + ".0"
+	};
+}
+
+uint64_t VirtualTexture::tileId(int mip, int x, int y)
+{
+	return (static_cast<uint64_t>(mip) << 40) | (static_cast<uint64_t>(y) << 20) | static_cast<uint64_t>(x);
+}
+
+void VirtualTexture::loadTile(uint64_t id, std::vector<char>& data) const
+{
+	// Reading the mapping faults the tile in from disk, on the calling thread
+	const char* tile = mFile.data() + mInfo.tileOffset(tileMip(id), tileX(id), tileY(id));
+	data.assign(tile, tile + mInfo.tileBytes);
+}
+
+void VirtualTexture::uploadTile(const Tile& tile, bool pinned)
+{
+	// A free page, or the least recently used one not seen in the last feedback
+	size_t page = mPages.size();
+
+	for (size_t i = 0; i < mPages.size(); ++i) {
+		if (!mPages[i].used) {
+			page = i;
+			break;
+		}
+
+		if (!mPages[i].pinned && mPages[i].lastUsed < mFrame && (page == mPages.size() || mPages[i].lastUsed < mPages[page].lastUsed)) {
+			page = i;
+		}
+	}
+
+	// Every page is in view, the tile is requested again by the next feedback
+	if (page == mPages.size()) {
+		return;
+	}
+
+	if (mPages[page].used) {
+		mResident.erase(mPages[page].id);
+	}
+
+	mPages[page].id = tile.id;
+	mPages[page].lastUsed = mFrame;
+	mPages[page].used = true;
+	mPages[page].pinned = pinned;
+	mResident[tile.id] = page;
+	mPageTableDirty = true;
+
+	TextureLevels layout;
+	layout.setInternalFormat(mInfo.internalFormat);
+	GLint x = static_cast<GLint>(page % CACHE_PAGES) * VirtualTextureFile::PAGE_SIZE;
+	GLint y = static_cast<GLint>(page / CACHE_PAGES) * VirtualTextureFile::PAGE_SIZE;
+
+	glBindTexture(GL_TEXTURE_2D, mCache);
+
+	if (layout.isCompressed()) {
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, x, y, VirtualTextureFile::PAGE_SIZE, VirtualTextureFile::PAGE_SIZE, mInfo.internalFormat,
+			static_cast<GLsizei>(mInfo.tileBytes), tile.data.data());
+	}
+	else {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, VirtualTextureFile::PAGE_SIZE, VirtualTextureFile::PAGE_SIZE, layout.format, layout.type, tile.data.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+}
+
+void VirtualTexture::refreshPageTable()
+{
+	glBindTexture(GL_TEXTURE_2D, mPageTable);
+
+	// Coarsest first, a missing tile copies the entry of its parent
+	for (int mip = mInfo.mipLevels - 1; mip >= 0; --mip) {
+		std::vector<uint8_t>& level = mPageTableLevels[mip];
+		int tilesX = mInfo.tilesX(mip);
+		int tilesY = mInfo.tilesY(mip);
+
+		for (int y = 0; y < tilesY; ++y) {
+			for (int x = 0; x < tilesX; ++x) {
+				uint8_t* entry = level.data() + (static_cast<size_t>(y) * tilesX + x) * 4;
+				auto resident = mResident.find(tileId(mip, x, y));
+
+				if (resident != mResident.end()) {
+					entry[0] = static_cast<uint8_t>(resident->second % CACHE_PAGES);
+					entry[1] = static_cast<uint8_t>(resident->second / CACHE_PAGES);
+					entry[2] = static_cast<uint8_t>(mip);
+					entry[3] = 255;
+				}
+				else if (mip + 1 < mInfo.mipLevels) {
+					const uint8_t* parent = mPageTableLevels[mip + 1].data() + (static_cast<size_t>(y / 2) * mInfo.tilesX(mip + 1) + x / 2) * 4;
+					std::copy(parent, parent + 4, entry);
+				}
+			}
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, mip, 0, 0, tilesX, tilesY, GL_RGBA, GL_UNSIGNED_BYTE, level.data());
+	}
+
+	mPageTableDirty = false;
+}
+
+void VirtualTexture::workerLoop()
+{
+	for (;;) {
+		uint64_t id;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+
+			if (mStopping) {
+				return;
+			}
+
+			id = mQueue.front();
+			mQueue.pop_front();
+		}
+
+		Tile tile;
+		tile.id = id;
+		loadTile(id, tile.data);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mLoaded.push_back(std::move(tile));
+	}
+}
+
+void VirtualTexture::close()
+{
+	if (mWorker.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+
+		mCondition.notify_all();
+		mWorker.join();
+	}
+
+	glDeleteTextures(1, &mCache);
+	glDeleteTextures(1, &mPageTable);
+	mCache = 0;
+	mPageTable = 0;
+	mPages.clear();
+	mResident.clear();
+	mRequested.clear();
+	mPageTableLevels.clear();
+	mQueue.clear();
+	mLoaded.clear();
+	mPageTableDirty = false;
+	mFile.close();
+}
@@ -0,0 +1,130 @@
+#include "virtualtexturefeedback.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+	const int FEEDBACK_SCALE = 8; // Screen pixels per feedback pixel, per side
+}
+
+VirtualTextureFeedback::VirtualTextureFeedback()
+{
+	for (Readback& readback : mReadbacks) {
+		glGenBuffers(1, &readback.buffer);
+	}
+}
+
+VirtualTextureFeedback::~VirtualTextureFeedback()
+{
+	for (Readback& readback : mReadbacks) {
+		glDeleteSync(readback.fence);
+		glDeleteBuffers(1, &readback.buffer);
+	}
+
+	glDeleteFramebuffers(1, &mFramebuffer);
+	glDeleteTextures(1, &mColorBuffer);
+	glDeleteRenderbuffers(1, &mDepthBuffer);
+}
+
+void VirtualTextureFeedback::begin(int screenWidth, int screenHeight)
+{
+	resize(std::max(1, screenWidth / FEEDBACK_SCALE), std::max(1, screenHeight / FEEDBACK_SCALE));
+
+	const GLuint noTile[4] = { 0, 0, 0, 0 };
+	glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+	glViewport(0, 0, mWidth, mHeight);
+	glClearBufferuiv(GL_COLOR, 0, noTile);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTextureFeedback::end()
+{
+	// An unread readback is replaced, the newer one is more relevant
+	Readback& readback = mReadbacks[mNextReadback];
+	glDeleteSync(readback.fence);
+	readback.size = static_cast<size_t>(mWidth) * mHeight * 4 * sizeof(uint16_t);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, readback.size, nullptr, GL_STREAM_READ);
+	glReadPixels(0, 0, mWidth, mHeight, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	mNextReadback = (mNextReadback + 1) % READBACKS;
+}
+
+bool VirtualTextureFeedback::read(std::vector<uint16_t>& texels)
+{
+	for (int i = 0; i < READBACKS; ++i) {
+		Readback& readback = mReadbacks[(mNextReadback + i) % READBACKS];
+
+		// Never waits, a readback still in flight is tried again next frame
+		if (!readback.fence || glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			continue;
+		}
+
+		glDeleteSync(readback.fence);
+		readback.fence = nullptr;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.size, GL_MAP_READ_BIT);
+
+		if (mapped) {
+			texels.resize(readback.size / sizeof(uint16_t));
+			memcpy(texels.data(), mapped, readback.size);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return mapped != nullptr;
+	}
+
+	return false;
+}
+
+float VirtualTextureFeedback::getLodBias() const
+{
+	return -std::log2(static_cast<float>(FEEDBACK_SCALE));
+}
+
+void VirtualTextureFeedback::resize(int width, int height)
+{
+	if (width == mWidth && height == mHeight) {
+		return;
+	}
+
+	mWidth = width;
+	mHeight = height;
+
+	glDeleteFramebuffers(1, &mFramebuffer);
+	glDeleteTextures(1, &mColorBuffer);
+	glDeleteRenderbuffers(1, &mDepthBuffer);
+
+	glGenTextures(1, &mColorBuffer);
+	glBindTexture(GL_TEXTURE_2D, mColorBuffer);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, width, height, 0, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &mDepthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &mFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColorBuffer, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::FRAMEBUFFER:: Feedback framebuffer is not complete!" << std::endl;
+	}
+
+	// Readbacks of the previous size are dropped
+	for (Readback& readback : mReadbacks) {
+		glDeleteSync(readback.fence);
+		readback.fence = nullptr;
+	}
+}
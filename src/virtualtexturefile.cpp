@@ -0,0 +1,198 @@
+#include "virtualtexturefile.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "bcn.h"
+#include "files.h"
+#include "parallel.h"
+
+namespace {
+	const char FILE_MAGIC[4] = { 'P', 'B', 'R', 'V' };
+	const uint32_t FILE_VERSION = 1;
+
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t internalFormat;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+		uint32_t tileSize;
+		uint32_t tileBorder;
+	};
+
+	bool isPowerOfTwo(int value)
+	{
+		return value > 0 && (value & (value - 1)) == 0;
+	}
+
+	// Size of a single tile in format, through the client layout of TextureLevels
+	size_t pageBytes(GLint internalFormat)
+	{
+		TextureLevels page;
+		page.setInternalFormat(internalFormat);
+		page.width = VirtualTextureFile::PAGE_SIZE;
+		page.height = VirtualTextureFile::PAGE_SIZE;
+		return page.levelSize(0);
+	}
+}
+
+int VirtualTextureFile::Info::tilesX(int mip) const
+{
+	return (width >> mip) / TILE_SIZE;
+}
+
+int VirtualTextureFile::Info::tilesY(int mip) const
+{
+	return (height >> mip) / TILE_SIZE;
+}
+
+size_t VirtualTextureFile::Info::tileOffset(int mip, int x, int y) const
+{
+	size_t tiles = 0;
+	for (int i = 0; i < mip; ++i) {
+		tiles += static_cast<size_t>(tilesX(i)) * tilesY(i);
+	}
+
+	tiles += static_cast<size_t>(y) * tilesX(mip) + x;
+
+	return sizeof(FileHeader) + tiles * tileBytes;
+}
+
+size_t VirtualTextureFile::Info::fileSize() const
+{
+	return tileOffset(mipLevels, 0, 0);
+}
+
+bool VirtualTextureFile::isTileFile(const std::string& path)
+{
+	return Files::hasExtension(path, EXTENSION);
+}
+
+int VirtualTextureFile::mipLevelCount(int width, int height)
+{
+	if (!isPowerOfTwo(width) || !isPowerOfTwo(height) || std::min(width, height) < TILE_SIZE) {
+		return 0;
+	}
+
+	int levels = 1;
+	while ((std::min(width, height) >> levels) >= TILE_SIZE) {
+		levels++;
+	}
+
+	return levels;
+}
+
+bool VirtualTextureFile::read(const char* data, size_t size, Info& info)
+{
+	if (size < sizeof(FileHeader)) {
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(&header, data, sizeof(FileHeader));
+
+	if (memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION
+		|| header.tileSize != TILE_SIZE || header.tileBorder != TILE_BORDER) {
+		return false;
+	}
+
+	TextureLevels layout;
+
+	if (!layout.setInternalFormat(header.internalFormat)
+		|| mipLevelCount(header.width, header.height) != static_cast<int>(header.mipLevels)) {
+		return false;
+	}
+
+	info.internalFormat = header.internalFormat;
+	info.width = header.width;
+	info.height = header.height;
+	info.mipLevels = header.mipLevels;
+	info.tileBytes = pageBytes(info.internalFormat);
+
+	return info.mipLevels > 0 && size >= info.fileSize();
+}
+
+bool VirtualTextureFile::write(const std::string& path, const TextureLevels& levels, GLenum compression)
+{
+	Info info;
+	info.internalFormat = compression ? compression : levels.internalFormat;
+	info.width = levels.width;
+	info.height = levels.height;
+	info.mipLevels = mipLevelCount(levels.width, levels.height);
+	info.tileBytes = pageBytes(info.internalFormat);
+
+	if (levels.isCompressed() || levels.faces != 1 || info.mipLevels == 0 || levels.mipLevels < info.mipLevels) {
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+	header.version = FILE_VERSION;
+	header.internalFormat = info.internalFormat;
+	header.width = info.width;
+	header.height = info.height;
+	header.mipLevels = info.mipLevels;
+	header.tileSize = TILE_SIZE;
+	header.tileBorder = TILE_BORDER;
+
+	return Files::writeAtomic(path, [&](std::ofstream& file) {
+		std::atomic<bool> succeeded{ true };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+
+		// One level at a time, its tiles are cut and compressed in parallel
+		for (int mip = 0; mip < info.mipLevels && succeeded; ++mip) {
+			int width = levels.width >> mip;
+			int height = levels.height >> mip;
+			int tilesX = info.tilesX(mip);
+			std::vector<char> tiles(static_cast<size_t>(tilesX) * info.tilesY(mip) * info.tileBytes);
+			const char* level = levels.faceData(mip, 0);
+			size_t texelSize = levels.bytesPerPixel;
+
+			parallelFor(static_cast<size_t>(tilesX) * info.tilesY(mip), [&](size_t begin, size_t end) {
+				TextureLevels page;
+				page.setInternalFormat(levels.internalFormat);
+				page.width = PAGE_SIZE;
+				page.height = PAGE_SIZE;
+				page.faces = 1;
+				page.mipLevels = 1;
+				page.data.resize(page.totalSize());
+
+				for (size_t i = begin; i < end; ++i) {
+					int tileX = static_cast<int>(i % tilesX);
+					int tileY = static_cast<int>(i / tilesX);
+
+					for (int y = 0; y < PAGE_SIZE; ++y) {
+						int row = (tileY * TILE_SIZE + y - TILE_BORDER + height) % height;
+
+						for (int x = 0; x < PAGE_SIZE; ++x) {
+							int column = (tileX * TILE_SIZE + x - TILE_BORDER + width) % width;
+							memcpy(page.data.data() + (static_cast<size_t>(y) * PAGE_SIZE + x) * texelSize,
+								level + (static_cast<size_t>(row) * width + column) * texelSize, texelSize);
+						}
+					}
+
+					char* tile = tiles.data() + i * info.tileBytes;
+					TextureLevels compressed;
+
+					if (!compression) {
+						memcpy(tile, page.data.data(), info.tileBytes);
+					}
+					else if (BCn::compressLevels(page, compression, compressed)) {
+						memcpy(tile, compressed.data.data(), info.tileBytes);
+					}
+					else {
+						succeeded = false;
+					}
+				}
+			});
+
+			file.write(tiles.data(), tiles.size());
+		}
+
+		return succeeded.load();
+	});
+}
@@ -0,0 +1,23 @@
+// Build step writing the split-sum BRDF LUT as raw RG half floats, embedded by cmrc.
+#include <fstream>
+#include <iostream>
+#include "brdflut.h"
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::cout << "Usage: brdf_lut_gen <output file>" << std::endl;
+		return 1;
+	}
+
+	std::vector<uint16_t> lut = BrdfLUT::integrate(BrdfLUT::RESOLUTION);
+	std::ofstream file(argv[1], std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(lut.data()), lut.size() * sizeof(uint16_t));
+
+	if (!file.good()) {
+		std::cout << "Failed to write " << argv[1] << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
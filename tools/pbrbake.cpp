@@ -0,0 +1,146 @@
+// Offline IBL baker. Bakes every HDR image of a directory to .ibl containers the viewer loads
+// directly, without a window or GL context. Files are baked in parallel.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "brdflut.h"
+#include "files.h"
+#include "iblbaker.h"
+#include "iblcontainer.h"
+#include "iblquality.h"
+#include "mappedfile.h"
+#include "parallel.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+	const char* const tierNames[] = { "low", "medium", "bc6h", "high" };
+
+	bool parseTier(const std::string& name, IblQuality::Tier& tier)
+	{
+		for (int i = 0; i <= IblQuality::HIGH; ++i) {
+			if (name == tierNames[i]) {
+				tier = static_cast<IblQuality::Tier>(i);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool isHdrImage(const fs::path& path)
+	{
+		return Files::hasExtension(path.string(), ".hdr");
+	}
+
+	// Skips images whose container is newer and was baked with the same settings, so an
+	// interrupted run can be resumed and a run with another tier rebakes everything
+	bool upToDate(const fs::path& imagePath, const fs::path& containerPath, const IblQuality::Settings& settings)
+	{
+		std::error_code error;
+		fs::file_time_type containerTime = fs::last_write_time(containerPath, error);
+
+		if (error || containerTime < fs::last_write_time(imagePath, error) || error) {
+			return false;
+		}
+
+		MappedFile containerFile;
+		IblContainer::Contents contents;
+
+		if (!containerFile.open(containerPath.string()) || !IblContainer::read(containerFile.data(), containerFile.size(), contents)) {
+			return false;
+		}
+
+		IblQuality::Settings baked = IblContainer::settings(contents);
+
+		return baked.environmentResolution == settings.environmentResolution && baked.environmentMipLevels == settings.environmentMipLevels
+			&& baked.environmentFormat == settings.environmentFormat && baked.preFilterResolution == settings.preFilterResolution
+			&& baked.preFilterMipLevels == settings.preFilterMipLevels && baked.preFilterFormat == settings.preFilterFormat;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	IblQuality::Tier tier = IblQuality::HIGH;
+
+	if (argc < 3 || (argc > 3 && !parseTier(argv[3], tier))) {
+		std::cout << "Usage: pbr_bake <input directory> <output directory> [low|medium|bc6h|high]" << std::endl;
+		return 1;
+	}
+
+	fs::path inputDirectory = argv[1];
+	fs::path outputDirectory = argv[2];
+	std::error_code error;
+	std::vector<fs::path> images;
+
+	for (const auto& item : fs::directory_iterator(inputDirectory, error)) {
+		if (item.is_regular_file(error) && isHdrImage(item.path())) {
+			images.push_back(item.path());
+		}
+	}
+
+	if (error) {
+		std::cout << "Failed to read directory " << inputDirectory.string() << std::endl;
+		return 1;
+	}
+
+	fs::create_directories(outputDirectory, error);
+	std::sort(images.begin(), images.end());
+
+	// The split-sum LUT doesn't depend on the environment, it's written once next to the containers
+	fs::path lutPath = outputDirectory / "brdf_lut.bin";
+
+	if (!fs::exists(lutPath, error)) {
+		std::vector<uint16_t> lut = BrdfLUT::integrate(BrdfLUT::RESOLUTION);
+
+		if (!Files::writeAtomic(lutPath.string(), lut.data(), lut.size() * sizeof(uint16_t))) {
+			std::cout << "Failed to write " << lutPath.string() << std::endl;
+			return 1;
+		}
+	}
+
+	const IblQuality::Settings& settings = IblQuality::settings(tier);
+	std::atomic<int> baked{ 0 };
+	std::atomic<int> skipped{ 0 };
+	std::atomic<int> failures{ 0 };
+	std::mutex outputMutex;
+	auto start = std::chrono::steady_clock::now();
+
+	// Files are spread over the pool, their kernels share it so every core keeps busy with few files
+	parallelFor(images.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			fs::path containerPath = outputDirectory / images[i].filename().replace_extension(IblContainer::EXTENSION);
+
+			if (upToDate(images[i], containerPath, settings)) {
+				skipped++;
+				continue;
+			}
+
+			MappedFile imageFile;
+			IblContainer::Contents contents;
+			bool succeeded = imageFile.open(images[i].string()) && IblBaker::bake(imageFile, settings, contents)
+				&& IblContainer::write(containerPath.string(), contents);
+
+			std::lock_guard<std::mutex> lock(outputMutex);
+
+			if (succeeded) {
+				std::cout << "Baked " << containerPath.string() << std::endl;
+				baked++;
+			}
+			else {
+				std::cout << "Failed to bake " << images[i].string() << std::endl;
+				failures++;
+			}
+		}
+	});
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << baked << " environments baked, " << skipped << " up to date, " << failures << " failed in " << seconds << "s" << std::endl;
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+// Offline material map packer. Converts an image to a GPU-ready .pbrtex file holding every mip
+// level in the format TextureLoader would pick with every compression extension available, so
+// the viewer only has to map and upload it. Images too large to be resident are written as
+// .pbrvt tile files instead, streamed by VirtualTexture.
+#include <stb_image.h>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bcn.h"
+#include "channels.h"
+#include "mappedfile.h"
+#include "mipgenerator.h"
+#include "texturefile.h"
+#include "virtualtexturefile.h"
+
+namespace {
+	struct Usage
+	{
+		const char* name;
+		GLenum internalFormat; // Layout of the mip chain
+		GLenum compression; // Uncompressed if 0
+	};
+
+	const Usage usages[] = {
+		{ "color", GL_SRGB8_ALPHA8, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB },
+		{ "normal", GL_RG8, GL_COMPRESSED_RG_RGTC2 },
+		{ "scalar", GL_R8, GL_COMPRESSED_RED_RGTC1 },
+		{ "height", GL_R16, 0 },
+		{ "packed", GL_RGBA8, GL_COMPRESSED_RGBA_BPTC_UNORM_ARB },
+	};
+
+	const Usage* findUsage(const std::string& name)
+	{
+		for (const Usage& usage : usages) {
+			if (name == usage.name) {
+				return &usage;
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool decode(const MappedFile& imageFile, const Usage& usage, TextureLevels& levels)
+	{
+		TextureLevels layout;
+		layout.setInternalFormat(usage.internalFormat);
+
+		int width, height, nrChannels;
+		void* pixels = layout.type == GL_UNSIGNED_SHORT
+			? static_cast<void*>(stbi_load_16_from_memory((const unsigned char*)imageFile.data(), static_cast<int>(imageFile.size()), &width, &height, &nrChannels, 1))
+			: static_cast<void*>(stbi_load_from_memory((const unsigned char*)imageFile.data(), static_cast<int>(imageFile.size()), &width, &height, &nrChannels, 4));
+
+		if (!pixels) {
+			return false;
+		}
+
+		std::vector<uint8_t> extracted;
+
+		if (layout.type == GL_UNSIGNED_BYTE && layout.bytesPerPixel < 4) {
+			extracted.resize(static_cast<size_t>(width) * height * layout.bytesPerPixel);
+			Channels::extract(static_cast<const uint8_t*>(pixels), static_cast<size_t>(width) * height, static_cast<int>(layout.bytesPerPixel), extracted.data());
+		}
+
+		levels = MipGenerator::generate(extracted.empty() ? pixels : extracted.data(), width, height, usage.internalFormat, MipGenerator::KAISER);
+		stbi_image_free(pixels);
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const Usage* usage = argc > 3 ? findUsage(argv[3]) : &usages[2];
+
+	if (argc < 3 || !usage) {
+		std::cout << "Usage: pbr_texpack <input image> <output file> [color|normal|scalar|height|packed]" << std::endl;
+		return 1;
+	}
+
+	bool tiled = VirtualTextureFile::isTileFile(argv[2]);
+
+	if (!tiled && !TextureFile::isTextureFile(argv[2])) {
+		std::cout << "Output files should use the " << TextureFile::EXTENSION << " or " << VirtualTextureFile::EXTENSION << " extension" << std::endl;
+	}
+
+	MappedFile imageFile;
+	TextureLevels levels;
+
+	if (!imageFile.open(argv[1]) || !decode(imageFile, *usage, levels)) {
+		std::cout << "Failed to load " << argv[1] << std::endl;
+		return 1;
+	}
+
+	// Tiles are compressed one by one when they are cut
+	TextureLevels compressed;
+
+	if (!tiled && usage->compression && BCn::compressLevels(levels, usage->compression, compressed)) {
+		levels = std::move(compressed);
+	}
+
+	if (tiled && VirtualTextureFile::mipLevelCount(levels.width, levels.height) == 0) {
+		std::cout << "Tiled images need power of two sizes of at least " << VirtualTextureFile::TILE_SIZE << " texels" << std::endl;
+		return 1;
+	}
+
+	if (!(tiled ? VirtualTextureFile::write(argv[2], levels, usage->compression) : TextureFile::write(argv[2], levels))) {
+		std::cout << "Failed to write " << argv[2] << std::endl;
+		return 1;
+	}
+
+	return 0;
+}